@@ -21,14 +21,44 @@
 
 /*==== Global variables ==== */
 
-vint *vertex_stack, *vertex_stack_top;
-vint *depth_first_numbers;
-vint depth_first_number_counter;
-Vertex *vertex_table;
-TC *tc;
-vint *vertex_id_to_scc_id_table;
-SCC **scc_table;
-vint *scc_stack, *scc_stack_top;
+/* Each thread has its own, so that closures can be computed in several
+   threads at the same time. */
+
+__thread vint *vertex_stack, *vertex_stack_top;
+__thread vint *depth_first_numbers;
+__thread vint depth_first_number_counter;
+__thread Vertex *vertex_table;
+__thread TC *tc;
+__thread vint *vertex_id_to_scc_id_table;
+__thread Interval **successor_table;
+__thread vint *successor_count_table;
+__thread vint *level_table;
+/* The successor set of an adjacent component while it is unioned; not a
+   local of visit, to keep the recursive stack frames small */
+__thread Intervals adjacent_successors;
+__thread vint *scc_stack, *scc_stack_top;
+__thread vint *scc_stamps;
+__thread vint *sort_buffer;
+__thread vint sort_buffer_size;
+__thread enum tc_mode closure_mode;
+
+/* The working tables are kept from one computation to the next and grown
+   when needed, so that computing the closures of many small digraphs does
+   not allocate them every time. */
+__thread vint workspace_vertex_size = 0;
+__thread vint workspace_stack_size = 0;
+
+/* The level of a component is one more than the highest level of its
+   adjacent components */
+static void set_level(vint scc_id, vint *adjacent, vint *adjacent_limit) {
+  vint level = 0;
+  for (vint *p = adjacent; p != adjacent_limit; p++) {
+    if (level_table[*p] >= level) {
+      level = level_table[*p] + 1;
+    }
+  }
+  level_table[scc_id] = level;
+}
 
 /* If the vertex has already been visited, do nothing. Otherwise recursively
    detect the strong component containing the vertex and compute its transitive
@@ -65,7 +95,15 @@ static vint visit(vint vertex_id) {
 	  DBG("Visit (" VFMT ") returned " VFMT "\n", child, child_value);
 	}
       } else if (child_value > dfn) {
-	DBG("Forward edge (" VFMT ", " VFMT "), ignore\n", vertex_id, child);
+	/* The successors of child are reached via the tree edges, but the
+	   condensation needs the edge itself */
+	vint child_scc_id = vertex_id_to_scc_id_table[child];
+	if (closure_mode == tc_condensation && child_scc_id >= 0) {
+	  DBG("Intercomponent forward edge (" VFMT ", " VFMT ")\npush " VFMT " to scc_stack[" VFMT "]\n", vertex_id, child, child_scc_id, scc_stack_top-scc_stack);
+	  *(scc_stack_top++) = child_scc_id;
+	} else {
+	  DBG("Forward edge (" VFMT ", " VFMT "), ignore\n", vertex_id, child);
+	}
       } else {
 	vint child_scc_id = vertex_id_to_scc_id_table[child];
 	if (child_scc_id >= 0) {
@@ -83,46 +121,73 @@ static vint visit(vint vertex_id) {
     DBG("All children of " VFMT " processed, lowest = " VFMT ", dfn = " VFMT "\n", vertex_id, lowest, dfn);
     if (lowest == dfn) {
       DBG("Vertex " VFMT " is the component root\n", vertex_id);
-      SCC *new_scc = TC_create_scc(tc, vertex_id);
-      vint scc_id = new_scc->scc_id;
+      vint scc_id = TC_create_scc(tc, vertex_id);
       DBG("generate new component " VFMT ", root = " VFMT "\n", scc_id, vertex_id);
       vint self_insert = self_loop_p || (*(vertex_stack_top-1) != vertex_id);
       DBG("self_insert = " VFMT ", self_loop = " VFMT "\n", self_insert, self_loop_p);
       Intervals *succ = 0;
       vint component_count = scc_stack_top - scc_stack_position;
       DBG("scc_stack contains " VFMT " adjacent components of " VFMT "\n", component_count, scc_id);
-      if (self_insert || component_count) {
+      if ((self_insert || component_count) && closure_mode != tc_condensation) {
 	DBG("Creating successor set for component " VFMT "\n", scc_id);
-	succ = new_scc->successors = Intervals_new();
+	succ = Intervals_new();
       }
       if (component_count) {
-	vint prev_scc_id = -1;
-	DBG("Sort adjacent components\n");
-	qsort(scc_stack_position, component_count, sizeof(vint), &cmp_vint);
+	vint *unique_top = scc_stack_position;
+	DBG("Remove duplicate adjacent components\n");
+	/* scc_stamps[c] == scc_id tells that c has already been seen for this component */
+	for (vint *p = scc_stack_position; p != scc_stack_top; p++) {
+	  vint adjacent_scc_id = *p;
+	  if (scc_stamps[adjacent_scc_id] != scc_id) {
+	    scc_stamps[adjacent_scc_id] = scc_id;
+	    *(unique_top++) = adjacent_scc_id;
+	  } else {
+	    DBG("Ignoring duplicate " VFMT " in scc_stack[" VFMT "]\n", adjacent_scc_id, p-scc_stack);
+	  }
+	}
+	scc_stack_top = unique_top;
+	component_count = scc_stack_top - scc_stack_position;
+	set_level(scc_id, scc_stack_position, scc_stack_top);
+	DBG("Sort " VFMT " adjacent components\n", component_count);
+	if (component_count > sort_buffer_size) {
+	  DELETE(sort_buffer);
+	  sort_buffer_size = 2*component_count;
+	  sort_buffer = NEWN(vint, sort_buffer_size);
+	}
+	/* The adjacent components have been completed before this one, thus their ids are smaller */
+	sort_vints(scc_stack_position, component_count, scc_id, sort_buffer);
+	if (closure_mode == tc_condensation) {
+	  DBG("Recording adjacent components of " VFMT "\n", scc_id);
+	  for (vint *p = scc_stack_position; p != scc_stack_top; p++) {
+	    TC_insert_adjacent(tc, *p);
+	  }
+	  scc_stack_top = scc_stack_position;
+	}
 	DBG("Scanning adjacent components of " VFMT " on scc_stack\n", scc_id);
 	while (scc_stack_top != scc_stack_position) {
 	  vint scc_id = *(--scc_stack_top);
 	  DBG("Popping adjacent component " VFMT " from scc_stack[" VFMT "]\n", scc_id, scc_stack_top-scc_stack);
-	  if (scc_id != prev_scc_id) {
-	    if (!(Intervals_insert(succ, scc_id))) {
-	      DBG("Component " VFMT " not in Succ[" VFMT "], unioning with Succ[" VFMT "]\n", scc_id, scc_id, scc_id);
-	      Intervals_union(succ, scc_table[scc_id]->successors);
-	    } else {
-	      DBG("Component " VFMT " already in Succ[" VFMT "]\n", scc_id, scc_id);
+	  if (!(Intervals_insert(succ, scc_id))) {
+	    DBG("Component " VFMT " not in Succ[" VFMT "], unioning with Succ[" VFMT "]\n", scc_id, scc_id, scc_id);
+	    /* No other adjacent component reaches this one; it is in the transitive reduction */
+	    if (closure_mode == tc_reduction) {
+	      TC_insert_adjacent(tc, scc_id);
 	    }
-	    prev_scc_id = scc_id;
+	    adjacent_successors.interval_table = successor_table[scc_id];
+	    adjacent_successors.interval_count = successor_count_table[scc_id];
+	    Intervals_union(succ, &adjacent_successors);
 	  } else {
-	    DBG("Ignoring duplicate " VFMT " in scc_stack[" VFMT "]\n", scc_id, scc_stack_top-scc_stack);
+	    DBG("Component " VFMT " already in Succ[" VFMT "]\n", scc_id, scc_id);
 	  }
 	}
 	DBG("All adjacent components of " VFMT " processed\n", scc_id);
       }
-      if (self_insert) {
+      if (succ && self_insert) {
 	Intervals_insert(succ, scc_id);
 	DBG("Inserting " VFMT " to its own successor set\n", scc_id);
       }
       if (succ) {
-	Intervals_completed(succ);
+	TC_set_successors(tc, scc_id, succ);
       }
       DBG("Before vertex_stack while loop:\n");
       DBGCALL(print_vertex_stack(vertex_stack, vertex_stack_top));
@@ -142,23 +207,85 @@ static vint visit(vint vertex_id) {
   return lowest;
 }
 
-TC* stacktc (Digraph *g)
+/* Make the working tables large enough for the digraph and reset the part
+   of them that is used. */
+static void reserve_workspace(vint vertex_count, vint stack_size) {
+  if (vertex_count > workspace_vertex_size) {
+    DELETE(vertex_stack);
+    DELETE(depth_first_numbers);
+    DELETE(scc_stamps);
+    vertex_stack = NEWN(vint, vertex_count);
+    depth_first_numbers = NEWN(vint, vertex_count);
+    scc_stamps = NEWN(vint, vertex_count);
+    workspace_vertex_size = vertex_count;
+  }
+  if (stack_size > workspace_stack_size) {
+    DELETE(scc_stack);
+    scc_stack = NEWN(vint, stack_size);
+    workspace_stack_size = stack_size;
+  }
+  /* All bytes 0xff is -1 */
+  memset(depth_first_numbers, 0xff, sizeof(vint)*vertex_count);
+  memset(scc_stamps, 0xff, sizeof(vint)*vertex_count);
+}
+
+/* Free the working tables of the calling thread */
+void stacktc_free_workspace() {
+  DELETE(vertex_stack);
+  DELETE(depth_first_numbers);
+  DELETE(scc_stamps);
+  DELETE(scc_stack);
+  DELETE(sort_buffer);
+  vertex_stack = depth_first_numbers = scc_stamps = scc_stack = sort_buffer = NULL;
+  workspace_vertex_size = workspace_stack_size = sort_buffer_size = 0;
+  Intervals_finalize_tc();
+}
+
+/* Compute the transitive closure of the part of g reachable from the given
+   source vertices. If sources is NULL, all vertices are sources.
+
+   With the mode tc_reduction, also record the transitive reduction of the
+   condensation graph. The adjacent components are processed in decreasing
+   order of their ids, that is, in topological order. An adjacent component
+   already in the successor set is reachable from an earlier adjacent
+   component, and the others are exactly the adjacent components in the
+   reduction. Thus the reduction is found without extra work.
+
+   With the mode tc_condensation, only the strong components and the edges
+   between them are computed. The successor sets are not created, thus the
+   time and memory needed are linear in the size of the digraph. */
+TC* stacktc_sources (Digraph *g, vint *sources, vint source_count, enum tc_mode mode)
 {
   vint vertex_count = g->vertex_count;
   DBG("stacktc\n");
   tc = TC_new(g);
-  vertex_stack = vertex_stack_top = new_vint_table(vertex_count, -1);
-  depth_first_numbers = new_vint_table(vertex_count, -1);
+  closure_mode = mode;
+  if (mode != tc_closure) {
+    TC_initialize_adjacent(tc, g->edge_count);
+  }
+  /* Each edge pushes at most one component to scc_stack and each root one more */
+  reserve_workspace(vertex_count, g->edge_count + vertex_count);
+  vertex_stack_top = vertex_stack;
+  scc_stack_top = scc_stack;
   depth_first_number_counter = 0;
   vertex_table = g->vertex_table;
   vertex_id_to_scc_id_table = tc->vertex_id_to_scc_id_table;
-  scc_table = tc->scc_table;
-  scc_stack = scc_stack_top = new_vint_table(g->edge_count, -1);
-  for (vint n = 0; n < vertex_count; n++) {
-    visit(n);
+  successor_table = tc->successor_table;
+  successor_count_table = tc->successor_count_table;
+  level_table = tc->level_table;
+  if (sources == NULL) {
+    for (vint n = 0; n < vertex_count; n++) {
+      visit(n);
+    }
+  } else {
+    for (vint n = 0; n < source_count; n++) {
+      visit(sources[n]);
+    }
   }
-  DELETE(depth_first_numbers);
-  DELETE(vertex_stack);
-  DELETE(scc_stack);
   return tc;
 }
+
+TC* stacktc (Digraph *g)
+{
+  return stacktc_sources(g, NULL, 0, tc_closure);
+}
@@ -29,6 +29,8 @@
 #include "debug.h"
 
 TC* stacktc (Digraph *g);
+TC* stacktc_sources (Digraph *g, vint *sources, vint source_count, enum tc_mode mode);
+void stacktc_free_workspace();
 
 #endif
 
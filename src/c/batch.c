@@ -0,0 +1,216 @@
+/*
+  =============================================================================
+  Author:  Esko Nuutila (enu@iki.fi)
+  Date:    2017-06-23
+  Date:    2022-07-12
+  Licence: MIT
+  =============================================================================
+  File: batch.c
+
+  Computing the closures of many digraphs listed in a manifest file. The
+  manifest is a two-column csv file with a header line; each line is a pair
+  INPUT,OUTPUT of file names. The digraphs are divided dynamically between
+  worker threads. Each thread reads its digraphs with a single thread and
+  keeps its working tables from one digraph to the next, so that small
+  digraphs do not pay for allocating and initializing them.
+  =============================================================================
+*/
+
+#include "batch.h"
+#include "algorithm.h"
+#include "digraph.h"
+#include "engines.h"
+#include "output.h"
+#include "labels.h"
+#include "idmap.h"
+#include <pthread.h>
+#include <time.h>
+
+typedef struct job_struct {
+  char *input_file;
+  char *output_file;
+} Job;
+
+typedef struct batch_struct {
+  Job *job_table;
+  vint job_count;
+  vint next_job;
+  vint failed_count;
+  pthread_mutex_t lock;
+  enum input_format input_as;
+  int reverse;
+  enum tc_algorithm algorithm;
+  enum tc_mode mode;
+  enum output_format output_as;
+} Batch;
+
+/* Remove the line end and the surrounding spaces and tabs */
+static char *trim(char *string) {
+  char *end = string + strlen(string);
+  while (end > string && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) {
+    end--;
+  }
+  *end = (char)0;
+  while (*string == ' ' || *string == '\t') {
+    string++;
+  }
+  return string;
+}
+
+/* Read the jobs of the manifest. Returns NULL if the manifest is not valid.
+   An input file that cannot be read is skipped when its job is run. */
+static Job *read_manifest(char *manifest_file, vint *count) {
+  FILE *input;
+  if (!(input = fopen(manifest_file, "r"))) {
+    fprintf(stderr, "Cannot open manifest file %s\n", manifest_file);
+    return NULL;
+  }
+  char *line = NULL;
+  size_t line_size = 0;
+  vint job_count = 0, job_size = 1024, line_number = 1;
+  Job *job_table = NEWN(Job, job_size);
+  int valid = (getline(&line, &line_size, input) >= 0);
+  while (valid && getline(&line, &line_size, input) >= 0) {
+    line_number++;
+    char *input_file = trim(line);
+    if (*input_file == 0) {
+      continue;
+    }
+    char *comma = strchr(input_file, ',');
+    char *output_file = (comma != NULL ? trim(comma + 1) : "");
+    if (comma != NULL) {
+      *comma = (char)0;
+      input_file = trim(input_file);
+    }
+    if (*input_file == 0 || *output_file == 0) {
+      fprintf(stderr, "Line " VFMT " of manifest %s is not INPUT,OUTPUT\n", line_number, manifest_file);
+      valid = 0;
+    } else {
+      if (job_count == job_size) {
+	job_size *= 2;
+	job_table = realloc(job_table, sizeof(Job)*job_size);
+      }
+      job_table[job_count].input_file = strdup(input_file);
+      job_table[job_count].output_file = strdup(output_file);
+      job_count++;
+    }
+  }
+  free(line);
+  fclose(input);
+  if (!valid) {
+    for (vint i = 0; i < job_count; i++) {
+      DELETE(job_table[i].input_file);
+      DELETE(job_table[i].output_file);
+    }
+    DELETE(job_table);
+    return NULL;
+  }
+  *count = job_count;
+  return job_table;
+}
+
+/* Compute and output the closure of one digraph. Returns 0 if the input is
+   not valid or the output cannot be written. */
+static int run_job(Batch *batch, Job *job) {
+  Digraph *g = digraph_read(job->input_file, batch->input_as, 1);
+  if (g == NULL) {
+    fprintf(stderr, "Skipping input file %s\n", job->input_file);
+    return 0;
+  }
+  Labels *labels = g->labels;
+  IdMap *id_map = g->id_map;
+  if (batch->reverse) {
+    Digraph *reversed = digraph_reverse(g);
+    digraph_delete(g);
+    g = reversed;
+  }
+  TC *tc = tc_compute(g, NULL, 0, batch->mode, batch->algorithm);
+  int written = output_result(tc, g, job->output_file, batch->output_as);
+  if (!written) {
+    fprintf(stderr, "Skipping output file %s\n", job->output_file);
+  }
+  TC_delete(tc);
+  digraph_delete(g);
+  if (labels != NULL) {
+    Labels_delete(labels);
+  }
+  if (id_map != NULL) {
+    IdMap_delete(id_map);
+  }
+  return written;
+}
+
+static void *batch_worker(void *arg) {
+  Batch *batch = (Batch*)arg;
+  while (1) {
+    pthread_mutex_lock(&(batch->lock));
+    vint job = batch->next_job++;
+    pthread_mutex_unlock(&(batch->lock));
+    if (job >= batch->job_count) {
+      break;
+    }
+    if (!run_job(batch, &(batch->job_table[job]))) {
+      pthread_mutex_lock(&(batch->lock));
+      batch->failed_count++;
+      pthread_mutex_unlock(&(batch->lock));
+    }
+  }
+  stacktc_free_workspace();
+  return NULL;
+}
+
+/* Compute the closures of the digraphs in the manifest using thread_count
+   threads. Reports the throughput to stderr. Returns 0 if the manifest is
+   not valid or some of the inputs were not valid or some of the outputs
+   could not be written. */
+int batch_run(char *manifest_file, int thread_count, enum input_format input_as, int reverse,
+	      enum tc_algorithm algorithm, enum tc_mode mode, enum output_format output_as) {
+  Batch batch;
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if (!(batch.job_table = read_manifest(manifest_file, &(batch.job_count)))) {
+    return 0;
+  }
+  batch.next_job = 0;
+  batch.failed_count = 0;
+  pthread_mutex_init(&(batch.lock), NULL);
+  batch.input_as = input_as;
+  batch.reverse = reverse;
+  batch.algorithm = algorithm;
+  batch.mode = mode;
+  batch.output_as = output_as;
+  if (thread_count > batch.job_count) {
+    thread_count = (batch.job_count > 0 ? (int)batch.job_count : 1);
+  }
+  pthread_t *threads = NEWN(pthread_t, thread_count);
+  pthread_attr_t attributes;
+  pthread_attr_init(&attributes);
+  pthread_attr_setstacksize(&attributes, BATCH_STACK_SIZE);
+  for (int i = 0; i < thread_count; i++) {
+    if (pthread_create(&(threads[i]), &attributes, &batch_worker, &batch)) {
+      fprintf(stderr, "Cannot create a thread for the batch\n");
+      exit(1);
+    }
+  }
+  for (int i = 0; i < thread_count; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  pthread_attr_destroy(&attributes);
+  pthread_mutex_destroy(&(batch.lock));
+  DELETE(threads);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)/1e9;
+  fprintf(stderr, "Computed " VFMT " closures in %.3f s using %d threads, %.1f graphs/s",
+	  batch.job_count - batch.failed_count, seconds, thread_count,
+	  (seconds > 0 ? (batch.job_count - batch.failed_count)/seconds : 0.0));
+  if (batch.failed_count > 0) {
+    fprintf(stderr, ", " VFMT " graphs skipped", batch.failed_count);
+  }
+  fprintf(stderr, "\n");
+  for (vint i = 0; i < batch.job_count; i++) {
+    DELETE(batch.job_table[i].input_file);
+    DELETE(batch.job_table[i].output_file);
+  }
+  DELETE(batch.job_table);
+  return (batch.failed_count == 0);
+}
@@ -0,0 +1,27 @@
+/*
+  =============================================================================
+  Author:  Esko Nuutila (enu@iki.fi)
+  Date:    2017-06-23
+  Date:    2022-07-12
+  Licence: MIT
+  =============================================================================
+  File: batch.h
+
+  Computing the closures of many digraphs listed in a manifest file.
+  =============================================================================
+*/
+
+#ifndef _batch_h_
+#define _batch_h_
+
+#include "types.h"
+#include "macros.h"
+#include "util.h"
+
+/* The stack size of the worker threads; visit is recursive */
+#define BATCH_STACK_SIZE (1L << 28)
+
+int batch_run(char *manifest_file, int thread_count, enum input_format input_as, int reverse,
+	      enum tc_algorithm algorithm, enum tc_mode mode, enum output_format output_as);
+
+#endif
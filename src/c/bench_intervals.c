@@ -0,0 +1,359 @@
+/*
+  =============================================================================
+  Author:  Esko Nuutila (enu@iki.fi)
+  Date:    2017-06-23
+  Date:    2022-07-12
+  Licence: MIT
+  =============================================================================
+  File: bench_intervals.c
+
+  Microbenchmarks of the interval set primitives Intervals_insert,
+  Intervals_union and Intervals_find, which take most of the time of stacktc,
+  and of IntervalSearch_find on the lookup layout of the same set.
+
+  The sets are generated from a seed, so that a run can be repeated exactly
+  on another commit. The base set has the given number of intervals with
+  random lengths and gaps of at least four ids. The other operand of union
+  has as many intervals, of which the given fraction overlap an interval of
+  the base set and the rest lie inside its gaps. The ids inserted and looked
+  up are drawn from the range of the base set, skewed towards its low end:
+  with skew s an id is range*u^(1+s) for a uniform u in [0,1).
+
+  Each operation is run the given number of times in each run, and the
+  median and the minimum over the runs are reported in ns/op, as well as
+  the intervals of the operand sets handled per second. The results can be
+  written as JSON for comparing commits.
+  =============================================================================
+*/
+
+#include "intervals.h"
+#include <math.h>
+#include <time.h>
+
+#define BENCH_INTERVAL_COUNT 1000
+#define BENCH_OPERATION_COUNT 10000
+#define BENCH_RUN_COUNT 5
+#define BENCH_SEED 1
+#define BENCH_MEAN_LENGTH 4 /* The mean length of the intervals of the base set */
+#define BENCH_MEAN_GAP 8 /* The mean extra gap between them */
+
+typedef struct bench_result_struct {
+  char *operation;
+  double median_ns;
+  double min_ns;
+  double intervals_per_second;
+  double check; /* Hit rate or mean result size, so that nothing is optimized away */
+} BenchResult;
+
+typedef struct bench_struct {
+  unsigned long seed;
+  unsigned long random_state;
+  vint interval_count;
+  vint operation_count;
+  int run_count;
+  double overlap;
+  double skew;
+  Interval *base_table; /* The base set */
+  Interval *other_table; /* The other operand of union */
+  vint *id_table; /* The ids inserted and looked up */
+  double timer_ns; /* The cost of reading the clock */
+} Bench;
+
+/* splitmix64, so that the sets are the same on every platform */
+static unsigned long next_random(Bench *this) {
+  unsigned long z = (this->random_state += 0x9e3779b97f4a7c15UL);
+  z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9UL;
+  z = (z ^ (z >> 27))*0x94d049bb133111ebUL;
+  return z ^ (z >> 31);
+}
+
+static double next_uniform(Bench *this) {
+  return (next_random(this) >> 11)*(1.0/9007199254740992.0);
+}
+
+static vint next_below(Bench *this, vint limit) {
+  return (vint)(next_random(this) % (unsigned long)limit);
+}
+
+static double now_ns() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec*1e9 + time.tv_nsec;
+}
+
+static int cmp_double(const void *a, const void *b) {
+  double x = *(double*)a, y = *(double*)b;
+  return (x < y ? -1 : x > y ? 1 : 0);
+}
+
+static void generate(Bench *this) {
+  vint n = this->interval_count;
+  this->random_state = this->seed;
+  this->base_table = NEWN(Interval, n);
+  this->other_table = NEWN(Interval, n);
+  this->id_table = NEWN(vint, this->operation_count);
+  vint low = 0;
+  for (vint i = 0; i < n; i++) {
+    this->base_table[i].low = low;
+    this->base_table[i].high = low + next_below(this, 2*BENCH_MEAN_LENGTH);
+    low = this->base_table[i].high + 5 + next_below(this, 2*BENCH_MEAN_GAP);
+  }
+  /* The intervals of the other set that do not overlap end at least two ids
+     before the next base interval, so that they are not adjacent to an
+     overlapping one */
+  for (vint i = 0; i < n; i++) {
+    Interval *base = &(this->base_table[i]);
+    Interval *other = &(this->other_table[i]);
+    if (next_uniform(this) < this->overlap) {
+      other->low = base->low - (i > 0 ? next_below(this, 2) : 0);
+      other->high = base->high + next_below(this, 2);
+    } else {
+      vint gap_end = (i + 1 < n ? this->base_table[i+1].low - 3 : base->high + 4);
+      other->low = base->high + 2;
+      other->high = other->low + next_below(this, gap_end - other->low + 1);
+    }
+  }
+  vint range = this->base_table[n-1].high + 2;
+  for (vint i = 0; i < this->operation_count; i++) {
+    double u = next_uniform(this);
+    this->id_table[i] = (vint)(range*pow(u, 1 + this->skew));
+  }
+}
+
+/* A copy of the base set in the swap buffer, as the open sets of stacktc */
+static Intervals *base_copy(Bench *this) {
+  Intervals *result = Intervals_new();
+  memcpy(result->interval_table, this->base_table, sizeof(Interval)*this->interval_count);
+  result->interval_count = this->interval_count;
+  return result;
+}
+
+/* Only the struct is freed, the table is a swap buffer */
+static void free_copy(Intervals *copy) {
+  DELETE(copy);
+}
+
+/* The inserts of a run go to the same set, which grows by at most the
+   number of operations */
+static double run_insert(Bench *this, double *check) {
+  Intervals *set = base_copy(this);
+  double start = now_ns();
+  for (vint i = 0; i < this->operation_count; i++) {
+    Intervals_insert(set, this->id_table[i]);
+  }
+  double ns = now_ns() - start;
+  *check = (double)set->interval_count;
+  free_copy(set);
+  return ns;
+}
+
+/* The union destroys its first operand, so each one is timed separately
+   after copying the base set, and the cost of reading the clock is
+   subtracted */
+static double run_union(Bench *this, double *check) {
+  Intervals other;
+  other.interval_table = this->other_table;
+  other.interval_count = this->interval_count;
+  double ns = 0;
+  double result_count = 0;
+  for (vint i = 0; i < this->operation_count; i++) {
+    Intervals *set = base_copy(this);
+    double start = now_ns();
+    Intervals_union(set, &other);
+    ns += now_ns() - start - this->timer_ns;
+    result_count += set->interval_count;
+    free_copy(set);
+  }
+  *check = result_count/this->operation_count;
+  return ns;
+}
+
+static double run_find(Bench *this, double *check) {
+  Intervals set;
+  set.interval_table = this->base_table;
+  set.interval_count = this->interval_count;
+  vint hits = 0;
+  double start = now_ns();
+  for (vint i = 0; i < this->operation_count; i++) {
+    hits += Intervals_find(&set, this->id_table[i]);
+  }
+  double ns = now_ns() - start;
+  *check = (double)hits/this->operation_count;
+  return ns;
+}
+
+static double run_search(Bench *this, double *check) {
+  IntervalSearch search;
+  IntervalSearch_build(&search, this->base_table, this->interval_count);
+  vint hits = 0;
+  double start = now_ns();
+  for (vint i = 0; i < this->operation_count; i++) {
+    hits += IntervalSearch_find(&search, this->id_table[i]);
+  }
+  double ns = now_ns() - start;
+  IntervalSearch_free(&search);
+  *check = (double)hits/this->operation_count;
+  return ns;
+}
+
+static double timer_cost() {
+  vint count = 100000;
+  double start = now_ns();
+  for (vint i = 0; i < count; i++) {
+    now_ns();
+  }
+  return (now_ns() - start)/count;
+}
+
+static void measure(Bench *this, char *operation, double (*run)(Bench*, double*),
+		    double intervals_per_op, BenchResult *result) {
+  double *ns_table = NEWN(double, this->run_count);
+  /* One run to warm up the caches and the swap buffers */
+  run(this, &(result->check));
+  for (int r = 0; r < this->run_count; r++) {
+    ns_table[r] = run(this, &(result->check))/this->operation_count;
+  }
+  qsort(ns_table, this->run_count, sizeof(double), &cmp_double);
+  result->operation = operation;
+  result->median_ns = ns_table[this->run_count/2];
+  result->min_ns = ns_table[0];
+  result->intervals_per_second = (result->median_ns > 0 ? intervals_per_op*1e9/result->median_ns : 0.0);
+  DELETE(ns_table);
+}
+
+static void write_json(Bench *this, char *label, BenchResult *results, int result_count, FILE *output) {
+  fprintf(output, "{\n");
+  fprintf(output, "    \"benchmark\": \"intervals\",\n");
+  fprintf(output, "    \"label\": \"%s\",\n", (label != NULL ? label : ""));
+  fprintf(output, "    \"seed\": %lu,\n", this->seed);
+  fprintf(output, "    \"intervals\": " VFMT ",\n", this->interval_count);
+  fprintf(output, "    \"overlap\": %g,\n", this->overlap);
+  fprintf(output, "    \"skew\": %g,\n", this->skew);
+  fprintf(output, "    \"operations\": " VFMT ",\n", this->operation_count);
+  fprintf(output, "    \"runs\": %d,\n", this->run_count);
+  fprintf(output, "    \"results\": [");
+  for (int i = 0; i < result_count; i++) {
+    fprintf(output, "%s\n        {\"operation\": \"%s\", \"ns_per_op\": %.3f, \"min_ns_per_op\": %.3f, "
+	    "\"intervals_per_second\": %.0f, \"check\": %g}",
+	    (i > 0 ? "," : ""), results[i].operation, results[i].median_ns, results[i].min_ns,
+	    results[i].intervals_per_second, results[i].check);
+  }
+  fprintf(output, "\n    ]\n}\n");
+}
+
+void usage(char* pgm) {
+  fprintf(stderr, "usage: %s options\n\n", pgm);
+  fprintf(stderr, "Measure the interval set operations Intervals_insert, Intervals_union and Intervals_find\n");
+  fprintf(stderr, "of stacktc, and IntervalSearch_find (search), on generated sets. The median and the minimum\n");
+  fprintf(stderr, "time per operation over the runs and the intervals of the operand sets handled per second\n");
+  fprintf(stderr, "are reported to stderr.\n\n");
+  fprintf(stderr, "Options:\n");
+  fprintf(stderr, "    -o | --operation NAME  Measure only insert, union, find or search. The default is all of them.\n");
+  fprintf(stderr, "    -n | --intervals N     The number of intervals in the sets. The default is %d.\n", BENCH_INTERVAL_COUNT);
+  fprintf(stderr, "    -p | --overlap R       The fraction of the intervals of the second operand of union that\n");
+  fprintf(stderr, "                           overlap the first one, between 0 and 1. The default is 0.5.\n");
+  fprintf(stderr, "    -k | --skew S          The inserted and looked up ids are skewed towards the low end of the\n");
+  fprintf(stderr, "                           set, 0 is uniform. The default is 0.\n");
+  fprintf(stderr, "    -c | --count N         The number of operations in a run. The default is %d.\n", BENCH_OPERATION_COUNT);
+  fprintf(stderr, "    -r | --runs N          The number of runs. The default is %d.\n", BENCH_RUN_COUNT);
+  fprintf(stderr, "    -s | --seed N          The seed of the generated sets and ids. The default is %d.\n", BENCH_SEED);
+  fprintf(stderr, "    -j | --json FILE       Write the parameters and the results to FILE in JSON format,\n");
+  fprintf(stderr, "                           or to the standard output if FILE is '-'.\n");
+  fprintf(stderr, "    -l | --label TEXT      A label stored in the JSON results, for example a commit id.\n");
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  char *pgm = argv[0];
+  char *operation = NULL;
+  char *json_file = NULL;
+  char *label = NULL;
+  Bench bench;
+  bench.seed = BENCH_SEED;
+  bench.interval_count = BENCH_INTERVAL_COUNT;
+  bench.operation_count = BENCH_OPERATION_COUNT;
+  bench.run_count = BENCH_RUN_COUNT;
+  bench.overlap = 0.5;
+  bench.skew = 0;
+  for (int i = 1; i < argc; i++) {
+    char *arg = argv[i];
+    if (!strcmp(arg, "-h") || !strcmp(arg, "--help")) {
+      usage(pgm);
+    } else if (i + 1 == argc) {
+      usage(pgm);
+    } else if (!strcmp(arg, "-o") || !strcmp(arg, "--operation")) {
+      operation = argv[++i];
+      if (strcmp(operation, "insert") && strcmp(operation, "union") && strcmp(operation, "find")
+	  && strcmp(operation, "search")) {
+	usage(pgm);
+      }
+    } else if (!strcmp(arg, "-n") || !strcmp(arg, "--intervals")) {
+      if ((bench.interval_count = atol(argv[++i])) < 1) {
+	usage(pgm);
+      }
+    } else if (!strcmp(arg, "-p") || !strcmp(arg, "--overlap")) {
+      bench.overlap = atof(argv[++i]);
+      if (bench.overlap < 0 || bench.overlap > 1) {
+	usage(pgm);
+      }
+    } else if (!strcmp(arg, "-k") || !strcmp(arg, "--skew")) {
+      if ((bench.skew = atof(argv[++i])) < 0) {
+	usage(pgm);
+      }
+    } else if (!strcmp(arg, "-c") || !strcmp(arg, "--count")) {
+      if ((bench.operation_count = atol(argv[++i])) < 1) {
+	usage(pgm);
+      }
+    } else if (!strcmp(arg, "-r") || !strcmp(arg, "--runs")) {
+      if ((bench.run_count = atoi(argv[++i])) < 1) {
+	usage(pgm);
+      }
+    } else if (!strcmp(arg, "-s") || !strcmp(arg, "--seed")) {
+      bench.seed = strtoul(argv[++i], NULL, 10);
+    } else if (!strcmp(arg, "-j") || !strcmp(arg, "--json")) {
+      json_file = argv[++i];
+    } else if (!strcmp(arg, "-l") || !strcmp(arg, "--label")) {
+      label = argv[++i];
+    } else {
+      usage(pgm);
+    }
+  }
+  generate(&bench);
+  bench.timer_ns = timer_cost();
+  /* The swap buffers must hold the base set, the inserted ids and a union */
+  Intervals_initialize_tc(2*(2*bench.interval_count + bench.operation_count));
+  BenchResult results[4];
+  int result_count = 0;
+  if (operation == NULL || !strcmp(operation, "insert")) {
+    measure(&bench, "insert", &run_insert, (double)bench.interval_count, &(results[result_count++]));
+  }
+  if (operation == NULL || !strcmp(operation, "union")) {
+    measure(&bench, "union", &run_union, 2.0*bench.interval_count, &(results[result_count++]));
+  }
+  if (operation == NULL || !strcmp(operation, "find")) {
+    measure(&bench, "find", &run_find, (double)bench.interval_count, &(results[result_count++]));
+  }
+  if (operation == NULL || !strcmp(operation, "search")) {
+    measure(&bench, "search", &run_search, (double)bench.interval_count, &(results[result_count++]));
+  }
+  Intervals_finalize_tc();
+  for (int i = 0; i < result_count; i++) {
+    fprintf(stderr, "%-6s %12.1f ns/op (min %.1f) %14.0f intervals/s\n", results[i].operation,
+	    results[i].median_ns, results[i].min_ns, results[i].intervals_per_second);
+  }
+  if (json_file != NULL) {
+    FILE *output = (!strcmp(json_file, "-") ? stdout : fopen(json_file, "w"));
+    if (output == NULL) {
+      fprintf(stderr, "%s: Cannot open %s\n", pgm, json_file);
+      exit(1);
+    }
+    write_json(&bench, label, results, result_count, output);
+    if (output != stdout) {
+      fclose(output);
+    }
+  }
+  DELETE(bench.base_table);
+  DELETE(bench.other_table);
+  DELETE(bench.id_table);
+  return 0;
+}
@@ -1,3 +1,4 @@
+libtoolize # Add the libtool support files
 aclocal # Set up an m4 environment
 autoconf # Generate configure from configure.ac
 automake --add-missing # Generate Makefile.in from Makefile.am
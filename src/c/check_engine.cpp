@@ -0,0 +1,164 @@
+/*
+  =============================================================================
+  Author:  Esko Nuutila (enu@iki.fi)
+  Date:    2017-06-23
+  Date:    2022-07-12
+  Licence: MIT
+  =============================================================================
+  File: check_engine.cpp
+
+  Check that every variant of the header-only engine stacktc_engine.hpp
+  computes the same closure as libstacktc: the same component for each
+  vertex and the same successor vertices. The digraphs are the numeric
+  examples in the directory given by STACKTC_EXAMPLES (or as arguments) and
+  generated random digraphs. Run by 'make check'; exits with status 1 and
+  reports the first difference of each digraph if the results differ.
+  =============================================================================
+*/
+
+#include "stacktc.h"
+#include "stacktc_engine.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace engine = stacktc::engine;
+
+struct edges {
+  std::string name;
+  std::vector<stacktc_id> from, to;
+};
+
+/* The edges of a csv file with a header line, as read by stacktc */
+static bool read_edges(const std::string &path, edges &result) {
+  std::ifstream input(path);
+  std::string line;
+  if (!input || !std::getline(input, line)) {
+    return false;
+  }
+  result.name = path;
+  while (std::getline(input, line)) {
+    std::size_t comma = line.find(',');
+    if (line.empty() || line[0] == '#' || comma == std::string::npos) {
+      continue;
+    }
+    result.from.push_back(std::stol(line.substr(0, comma)));
+    result.to.push_back(std::stol(line.substr(comma + 1)));
+  }
+  return true;
+}
+
+static edges random_edges(stacktc_id vertex_count, stacktc_id edge_count, unsigned seed) {
+  std::mt19937_64 random(seed);
+  std::uniform_int_distribution<stacktc_id> vertex(0, vertex_count - 1);
+  edges result;
+  result.name = "random v=" + std::to_string(vertex_count) + " e=" + std::to_string(edge_count);
+  for (stacktc_id i = 0; i < edge_count; i++) {
+    result.from.push_back(vertex(random));
+    result.to.push_back(vertex(random));
+  }
+  return result;
+}
+
+/* The successor vertices of the vertex in libstacktc, sorted */
+static std::vector<std::int64_t> library_successors(const stacktc_closure *closure, stacktc_id vertex) {
+  std::vector<std::int64_t> result;
+  stacktc_id buffer[256];
+  stacktc_id count;
+  stacktc_iterator *iterator = stacktc_iterator_vertex_successors(closure, vertex);
+  while ((count = stacktc_iterator_next(iterator, buffer, 256)) > 0) {
+    result.insert(result.end(), buffer, buffer + count);
+  }
+  stacktc_iterator_free(iterator);
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+/* Returns the number of differences, reporting the first one */
+static int compare(const edges &g, const stacktc_closure *expected, const engine::any_closure &closure) {
+  int differences = 0;
+  auto report = [&](const std::string &what) {
+    if (differences++ == 0) {
+      std::fprintf(stderr, "%s, %s: %s\n", g.name.c_str(), closure.variant(), what.c_str());
+    }
+  };
+  if (closure.vertex_count() != stacktc_closure_vertex_count(expected)
+      || closure.component_count() != stacktc_closure_component_count(expected)) {
+    report("different numbers of vertices or components");
+    return differences;
+  }
+  for (stacktc_id v = 0; v < closure.vertex_count(); v++) {
+    if (closure.component(v) != stacktc_closure_component(expected, v)) {
+      report("different component of vertex " + std::to_string(v));
+    }
+    std::vector<std::int64_t> successors = closure.successors(v);
+    std::sort(successors.begin(), successors.end());
+    if (successors != library_successors(expected, v)) {
+      report("different successors of vertex " + std::to_string(v));
+    }
+  }
+  return differences;
+}
+
+template <typename Id>
+static int check_variants(const edges &g, stacktc_id vertex_count, const stacktc_closure *expected) {
+  std::span<const stacktc_id> from(g.from), to(g.to);
+  int failed = 0;
+  for (engine::set_policy policy : {engine::set_policy::intervals, engine::set_policy::bitset,
+				    engine::set_policy::compressed}) {
+    failed += (compare(g, expected, *engine::detail::compute_with<Id>(from, to, vertex_count, policy)) > 0);
+  }
+  return failed;
+}
+
+static int check(const edges &g) {
+  stacktc_id vertex_count = 0;
+  for (std::size_t i = 0; i < g.from.size(); i++) {
+    vertex_count = std::max(vertex_count, std::max(g.from[i], g.to[i]) + 1);
+  }
+  stacktc_graph *graph = stacktc_graph_new(g.from.data(), g.to.data(), static_cast<stacktc_id>(g.from.size()), vertex_count);
+  stacktc_closure *expected = stacktc_closure_new(graph);
+  int failed = check_variants<std::uint32_t>(g, vertex_count, expected) + check_variants<std::uint64_t>(g, vertex_count, expected);
+  failed += (compare(g, expected, *engine::compute(std::span<const stacktc_id>(g.from), std::span<const stacktc_id>(g.to))) > 0);
+  stacktc_closure_free(expected);
+  stacktc_graph_free(graph);
+  return failed;
+}
+
+int main(int argc, char **argv) {
+  std::vector<edges> graphs;
+  std::vector<std::string> files(argv + 1, argv + argc);
+  const char *examples = std::getenv("STACKTC_EXAMPLES");
+  if (files.empty() && examples != NULL) {
+    for (const auto &entry : std::filesystem::directory_iterator(examples)) {
+      std::string path = entry.path().string();
+      if (path.ends_with("-nums.csv")) {
+	files.push_back(path);
+      }
+    }
+  }
+  for (const std::string &file : files) {
+    edges g;
+    if (!read_edges(file, g)) {
+      std::fprintf(stderr, "Cannot read %s\n", file.c_str());
+      return 1;
+    }
+    graphs.push_back(g);
+  }
+  graphs.push_back(random_edges(100, 150, 1));
+  graphs.push_back(random_edges(1000, 1200, 2));
+  graphs.push_back(random_edges(1000, 3000, 3));
+  graphs.push_back(random_edges(5000, 6000, 4));
+  int failed = 0;
+  for (const edges &g : graphs) {
+    failed += check(g);
+  }
+  stacktc_closure_free_workspace();
+  std::fprintf(stderr, "Checked %zu digraphs, %d variants differ from libstacktc\n", graphs.size(), failed);
+  return (failed == 0 ? 0 : 1);
+}
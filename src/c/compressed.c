@@ -0,0 +1,310 @@
+/*
+  =============================================================================
+  Author:  Esko Nuutila (enu@iki.fi)
+  Date:    2017-06-23
+  Date:    2022-07-12
+  Licence: MIT
+  =============================================================================
+  File: compressed.c
+
+  Reading gzip or zstd compressed input.
+  =============================================================================
+*/
+
+#include "compressed.h"
+#include <pthread.h>
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
+
+/* The size of the compressed and decompressed blocks */
+#define COMPRESSED_BLOCK_SIZE (1 << 20)
+/* The number of decompressed blocks waiting for the reader */
+#define COMPRESSED_BLOCK_COUNT 4
+
+struct compressed_stream_struct {
+  FILE *input;
+  enum compression compression;
+  char *prefix; /* The bytes read before the stream was opened */
+  size_t prefix_length;
+  char *in_block;
+  char *blocks[COMPRESSED_BLOCK_COUNT];
+  size_t block_lengths[COMPRESSED_BLOCK_COUNT];
+  int first_full; /* The next block the reader takes */
+  int full_count; /* The number of blocks waiting for the reader */
+  size_t read_position; /* The position of the reader in the first full block */
+  int eof;
+  int cancelled; /* The reader stopped before the end of the stream */
+  char *error;
+  pthread_mutex_t mutex;
+  pthread_cond_t not_full;
+  pthread_cond_t not_empty;
+  pthread_t thread;
+};
+
+enum compression detect_compression(char *magic, size_t length) {
+  unsigned char *m = (unsigned char*)magic;
+  if (length >= 2 && m[0] == 0x1f && m[1] == 0x8b) {
+    return compression_gzip;
+  } else if (length >= 4 && m[0] == 0x28 && m[1] == 0xb5 && m[2] == 0x2f && m[3] == 0xfd) {
+    return compression_zstd;
+  }
+  return compression_none;
+}
+
+/* The supported compressions depend on the libraries found when building */
+int compression_supported(enum compression compression) {
+  switch (compression) {
+  case compression_none:
+    return 1;
+  case compression_gzip:
+#ifdef HAVE_LIBZ
+    return 1;
+#else
+    return 0;
+#endif
+  case compression_zstd:
+#ifdef HAVE_LIBZSTD
+    return 1;
+#else
+    return 0;
+#endif
+  }
+  return 0;
+}
+
+/* ==== The decompressing thread ==== */
+
+/* Read compressed data; first the prefix, then the input. After the reader
+   has been closed, the rest of the input is ignored. */
+static size_t read_compressed(CompressedStream *this) {
+  size_t got = 0;
+  pthread_mutex_lock(&(this->mutex));
+  int cancelled = this->cancelled;
+  pthread_mutex_unlock(&(this->mutex));
+  if (cancelled) {
+    return 0;
+  }
+  if (this->prefix_length > 0) {
+    memcpy(this->in_block, this->prefix, this->prefix_length);
+    got = this->prefix_length;
+    this->prefix_length = 0;
+  }
+  return got + fread(this->in_block + got, 1, COMPRESSED_BLOCK_SIZE - got, this->input);
+}
+
+/* Wait for a free block to decompress to */
+static char *free_block(CompressedStream *this) {
+  pthread_mutex_lock(&(this->mutex));
+  while (this->full_count == COMPRESSED_BLOCK_COUNT && !this->cancelled) {
+    pthread_cond_wait(&(this->not_full), &(this->mutex));
+  }
+  char *block = this->blocks[(this->first_full + this->full_count) % COMPRESSED_BLOCK_COUNT];
+  pthread_mutex_unlock(&(this->mutex));
+  return block;
+}
+
+/* Give a decompressed block to the reader */
+static void block_done(CompressedStream *this, size_t length) {
+  pthread_mutex_lock(&(this->mutex));
+  if (length > 0 && !this->cancelled) {
+    this->block_lengths[(this->first_full + this->full_count) % COMPRESSED_BLOCK_COUNT] = length;
+    this->full_count++;
+    pthread_cond_signal(&(this->not_empty));
+  }
+  pthread_mutex_unlock(&(this->mutex));
+}
+
+static void stream_done(CompressedStream *this, char *error) {
+  pthread_mutex_lock(&(this->mutex));
+  this->eof = 1;
+  this->error = error;
+  pthread_cond_signal(&(this->not_empty));
+  pthread_mutex_unlock(&(this->mutex));
+}
+
+#ifdef HAVE_LIBZ
+/* Several concatenated gzip members are decompressed as one stream */
+static char *inflate_gzip(CompressedStream *this) {
+  z_stream z;
+  int status = Z_OK;
+  memset(&z, 0, sizeof(z));
+  if (inflateInit2(&z, 15 + 32) != Z_OK) {
+    return "Cannot initialize gzip decompression";
+  }
+  char *block = free_block(this);
+  z.next_out = (Bytef*)block;
+  z.avail_out = COMPRESSED_BLOCK_SIZE;
+  while (1) {
+    if (z.avail_in == 0) {
+      z.avail_in = read_compressed(this);
+      z.next_in = (Bytef*)this->in_block;
+      if (z.avail_in == 0) {
+	break;
+      }
+    }
+    status = inflate(&z, Z_NO_FLUSH);
+    if (status == Z_STREAM_END) {
+      inflateReset(&z);
+    } else if (status != Z_OK && status != Z_BUF_ERROR) {
+      break;
+    }
+    if (z.avail_out == 0) {
+      block_done(this, COMPRESSED_BLOCK_SIZE);
+      block = free_block(this);
+      z.next_out = (Bytef*)block;
+      z.avail_out = COMPRESSED_BLOCK_SIZE;
+    }
+  }
+  block_done(this, COMPRESSED_BLOCK_SIZE - z.avail_out);
+  inflateEnd(&z);
+  /* At the end the stream must be between members */
+  if ((status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) || z.total_in != 0) {
+    return "Corrupt or truncated gzip input";
+  }
+  return NULL;
+}
+#endif
+
+#ifdef HAVE_LIBZSTD
+static char *decompress_zstd(CompressedStream *this) {
+  ZSTD_DStream *z = ZSTD_createDStream();
+  ZSTD_inBuffer in = {this->in_block, 0, 0};
+  ZSTD_outBuffer out = {free_block(this), COMPRESSED_BLOCK_SIZE, 0};
+  size_t status = 0;
+  char *error = NULL;
+  while (1) {
+    if (in.pos == in.size) {
+      in.size = read_compressed(this);
+      in.pos = 0;
+      if (in.size == 0) {
+	break;
+      }
+    }
+    status = ZSTD_decompressStream(z, &out, &in);
+    if (ZSTD_isError(status)) {
+      error = "Corrupt zstd input";
+      break;
+    }
+    if (out.pos == out.size) {
+      block_done(this, out.pos);
+      out.dst = free_block(this);
+      out.pos = 0;
+    }
+  }
+  block_done(this, out.pos);
+  ZSTD_freeDStream(z);
+  /* A non-zero status means that the last frame is incomplete */
+  if (error == NULL && status != 0) {
+    error = "Truncated zstd input";
+  }
+  return error;
+}
+#endif
+
+static void *decompress(void *arg) {
+  CompressedStream *this = (CompressedStream*)arg;
+  char *error = NULL;
+#ifdef HAVE_LIBZ
+  if (this->compression == compression_gzip) {
+    error = inflate_gzip(this);
+  }
+#endif
+#ifdef HAVE_LIBZSTD
+  if (this->compression == compression_zstd) {
+    error = decompress_zstd(this);
+  }
+#endif
+  stream_done(this, error);
+  return NULL;
+}
+
+/* ==== The reader ==== */
+
+/* Start decompressing the input. The prefix contains the bytes already read from the input. */
+CompressedStream *CompressedStream_open(FILE *input, char *prefix, size_t prefix_length, enum compression compression) {
+  CompressedStream *this = NEW(CompressedStream);
+  this->input = input;
+  this->compression = compression;
+  this->prefix = prefix;
+  this->prefix_length = prefix_length;
+  this->in_block = NEWN(char, COMPRESSED_BLOCK_SIZE);
+  for (int i = 0; i < COMPRESSED_BLOCK_COUNT; i++) {
+    this->blocks[i] = NEWN(char, COMPRESSED_BLOCK_SIZE);
+  }
+  this->first_full = this->full_count = 0;
+  this->read_position = 0;
+  this->eof = 0;
+  this->cancelled = 0;
+  this->error = NULL;
+  pthread_mutex_init(&(this->mutex), NULL);
+  pthread_cond_init(&(this->not_full), NULL);
+  pthread_cond_init(&(this->not_empty), NULL);
+  if (pthread_create(&(this->thread), NULL, &decompress, this)) {
+    fprintf(stderr, "Cannot create a thread for decompression\n");
+    exit(1);
+  }
+  return this;
+}
+
+/* Copy at most size decompressed bytes to the buffer. Returns the number
+   of bytes copied; 0 at the end of the stream. */
+size_t CompressedStream_read(CompressedStream *this, char *buffer, size_t size) {
+  size_t got = 0;
+  pthread_mutex_lock(&(this->mutex));
+  while (got < size) {
+    while (this->full_count == 0 && !this->eof) {
+      pthread_cond_wait(&(this->not_empty), &(this->mutex));
+    }
+    if (this->full_count == 0) {
+      break;
+    }
+    int first = this->first_full;
+    size_t count = this->block_lengths[first] - this->read_position;
+    if (count > size - got) {
+      count = size - got;
+    }
+    /* The block is not touched by the decompressor until it is released */
+    pthread_mutex_unlock(&(this->mutex));
+    memcpy(buffer + got, this->blocks[first] + this->read_position, count);
+    pthread_mutex_lock(&(this->mutex));
+    got += count;
+    this->read_position += count;
+    if (this->read_position == this->block_lengths[first]) {
+      this->first_full = (first + 1) % COMPRESSED_BLOCK_COUNT;
+      this->full_count--;
+      this->read_position = 0;
+      pthread_cond_signal(&(this->not_full));
+    }
+  }
+  pthread_mutex_unlock(&(this->mutex));
+  return got;
+}
+
+/* Stop the decompressing thread and free the stream. Returns 0 and prints an
+   error message if the input read so far could not be decompressed. */
+int CompressedStream_close(CompressedStream *this) {
+  pthread_mutex_lock(&(this->mutex));
+  int complete = this->eof && this->full_count == 0;
+  this->cancelled = 1;
+  pthread_cond_signal(&(this->not_full));
+  pthread_mutex_unlock(&(this->mutex));
+  pthread_join(this->thread, NULL);
+  /* If the reader stopped early, the error is in the decompressed data */
+  char *error = (complete ? this->error : NULL);
+  if (error != NULL) {
+    fprintf(stderr, "%s\n", error);
+  }
+  DELETE(this->in_block);
+  for (int i = 0; i < COMPRESSED_BLOCK_COUNT; i++) {
+    DELETE(this->blocks[i]);
+  }
+  pthread_mutex_destroy(&(this->mutex));
+  pthread_cond_destroy(&(this->not_full));
+  pthread_cond_destroy(&(this->not_empty));
+  DELETE(this);
+  return (error == NULL);
+}
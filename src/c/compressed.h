@@ -0,0 +1,43 @@
+/*
+  =============================================================================
+  Author:  Esko Nuutila (enu@iki.fi)
+  Date:    2017-06-23
+  Date:    2022-07-12
+  Licence: MIT
+  =============================================================================
+  File: compressed.h
+
+  Reading gzip or zstd compressed input.
+
+  The input is decompressed by a thread of its own to a small ring of
+  blocks, from which the reader copies the decompressed data. Thus the
+  decompression and the parsing of the input overlap, and no temporary files
+  are needed. The compression is detected from the magic bytes at the start
+  of the input.
+  =============================================================================
+*/
+
+#ifndef _compressed_h_
+#define _compressed_h_
+
+#include "types.h"
+#include "macros.h"
+
+enum compression {
+  compression_none = 0,
+  compression_gzip = 1,
+  compression_zstd = 2
+};
+
+/* The number of bytes needed for detecting the compression */
+#define COMPRESSION_MAGIC_LENGTH 4
+
+typedef struct compressed_stream_struct CompressedStream;
+
+enum compression detect_compression(char *magic, size_t length);
+int compression_supported(enum compression compression);
+CompressedStream *CompressedStream_open(FILE *input, char *prefix, size_t prefix_length, enum compression compression);
+size_t CompressedStream_read(CompressedStream *this, char *buffer, size_t size);
+int CompressedStream_close(CompressedStream *this);
+
+#endif
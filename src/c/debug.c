@@ -25,11 +25,10 @@ void print_vertex_struct(vint vertex_id, Vertex* vertex_table) {
 }
 
 
-void print_scc_struct(vint scc_id, SCC** scc_table) {
-  SCC *scc = scc_table[scc_id];
-  vint root_vertex_id = scc->root_vertex_id;
-  vint vertex_count = scc->vertex_count;
-  vint *vertices = scc->vertex_table;
+void print_scc_struct(TC *tc, vint scc_id) {
+  vint root_vertex_id = tc->root_table[scc_id];
+  vint vertex_count = tc->vertex_offset_table[scc_id + 1] - tc->vertex_offset_table[scc_id];
+  vint *vertices = tc->vertex_table + tc->vertex_offset_table[scc_id];
   fprintf(stderr, "scc[" VFMT "]: root vertex = " VFMT " contains " VFMT " vertices", scc_id, root_vertex_id, vertex_count);
   for (vint i = 0; i < vertex_count; i++) {
     fprintf(stderr, " " VFMT, vertices[i]);
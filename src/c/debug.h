@@ -19,7 +19,7 @@
 
 void print_vertex_struct(vint vertex_id, Vertex* vertex_table);
 
-void print_scc_struct(vint scc_id, SCC** scc_table);
+void print_scc_struct(TC *tc, vint scc_id);
 
 void print_vertex_stack(vint *vertex_stack, vint *vertex_stack_top);
 
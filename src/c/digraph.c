@@ -13,121 +13,408 @@
 
 #include "digraph.h"
 #include "scc.h"
+#include "tc.h"
+#include "iter.h"
+#include "labels.h"
+#include "idmap.h"
+#include "reader.h"
 
-int edge_cmp(const void* a1, const void* a2) {
-  EDGE *e1 = (EDGE*)a1;
-  EDGE *e2 = (EDGE*)a2;
-  if (e1->from < e2->from) return -1;
-  else if (e1->from > e2->from) return 1;
-  else if (e1->to < e2->from) return -1;
-  else if (e1->to > e2->from) return 1;
-  else return 0;
+/* ==== Building a digraph from tables of edges ==== */
+
+/* The children tables are filled by a counting sort on the from vertices,
+   and then the children of each vertex are sorted. */
+Digraph *digraph_from_edge_buffers(EdgeBuffer *buffers, int buffer_count, vint vertex_count) {
+  Digraph *result = NEW(Digraph);
+  Vertex *vertex_table = NEWN(Vertex, vertex_count);
+  vint *positions = new_vint_table(vertex_count, 0);
+  vint *children;
+  vint vi, ei, position, edge_count = 0;
+  int bi;
+  for (bi = 0; bi < buffer_count; bi++) {
+    EDGE *edges = buffers[bi].edges;
+    for (ei = 0; ei < buffers[bi].edge_count; ei++) {
+      positions[edges[ei].from]++;
+    }
+    edge_count += buffers[bi].edge_count;
+  }
+  children = NEWN(vint, edge_count);
+  position = 0;
+  for (vi = 0; vi < vertex_count; vi++) {
+    vertex_table[vi].vertex_id = vi;
+    vertex_table[vi].outdegree = positions[vi];
+    vertex_table[vi].children = children + position;
+    positions[vi] = position;
+    position += vertex_table[vi].outdegree;
+  }
+  for (bi = 0; bi < buffer_count; bi++) {
+    EDGE *edges = buffers[bi].edges;
+    for (ei = 0; ei < buffers[bi].edge_count; ei++) {
+      children[positions[edges[ei].from]++] = edges[ei].to;
+    }
+  }
+  for (vi = 0; vi < vertex_count; vi++) {
+    qsort(vertex_table[vi].children, vertex_table[vi].outdegree, sizeof(vint), &cmp_vint);
+  }
+  DELETE(positions);
+  result->vertex_count = vertex_count;
+  result->edge_count = edge_count;
+  result->edge_table = children;
+  result->vertex_table = vertex_table;
+  result->reversep = 0;
+  result->labels = NULL;
+  result->id_map = NULL;
+  return result;
 }
 
-/* Reading the input graph from a two-column csv file with header naming the fields */
+/* Free the digraph. The labels and the id map may be shared with a reversed
+   digraph, so they are not freed. */
+void digraph_delete(Digraph *this) {
+  DELETE(this->vertex_table);
+  DELETE(this->edge_table);
+  DELETE(this);
+}
 
-Digraph *digraph_read(char *input_file) {
-  vint vertex_count;
-  vint edge_count;
-  vint max_vertex;
-  vint edge_index;
-  vint from_vertex, to_vertex, prev_from_vertex;
-  vint vi;
-  char first_line[101];
-  fpos_t second_line_start;
-  EDGE *edges;
-  Vertex *vertex_table;
-  vint *children;
+/* The edges of the buffers have been spilled to sorted runs, which are
+   merged directly into the children table, sorted for each vertex. */
+static Digraph *digraph_from_edge_runs(EdgeBuffer *buffers, int buffer_count, vint vertex_count) {
+  Digraph *result = NEW(Digraph);
+  Vertex *vertex_table = NEWN(Vertex, vertex_count);
+  vint *outdegrees = new_vint_table(vertex_count, 0);
+  vint edge_count = 0;
+  for (int bi = 0; bi < buffer_count; bi++) {
+    edge_count += buffers[bi].edge_count;
+    for (vint r = 0; r < buffers[bi].run_count; r++) {
+      edge_count += buffers[bi].run_length_table[r];
+    }
+  }
+  vint *children = NEWN(vint, edge_count);
+  merge_edges(buffers, buffer_count, children, outdegrees);
+  vint position = 0;
+  for (vint vi = 0; vi < vertex_count; vi++) {
+    vertex_table[vi].vertex_id = vi;
+    vertex_table[vi].outdegree = outdegrees[vi];
+    vertex_table[vi].children = children + position;
+    position += outdegrees[vi];
+  }
+  DELETE(outdegrees);
+  result->vertex_count = vertex_count;
+  result->edge_count = edge_count;
+  result->edge_table = children;
+  result->vertex_table = vertex_table;
+  result->reversep = 0;
+  result->labels = NULL;
+  result->id_map = NULL;
+  return result;
+}
+
+Digraph *digraph_from_edges(EDGE *edges, vint edge_count, vint vertex_count) {
+  EdgeBuffer buffer;
+  buffer.edges = edges;
+  buffer.edge_count = edge_count;
+  return digraph_from_edge_buffers(&buffer, 1, vertex_count);
+}
+
+/* ==== Reading the input graph ==== */
+
+/* Reading the input graph from a two-column csv file with header naming the fields.
+   See read_edges for the input formats. Returns NULL if the input cannot be
+   read or contains an illegal line. */
+
+Digraph *digraph_read(char *input_file, enum input_format input_as, int thread_count) {
+  Labels *labels = NULL;
+  IdMap *id_map = NULL;
+  EdgeBuffer *buffers;
   Digraph *result;
-  int got;
-  char line1[101];
+  vint max_vertex = -1;
+  int buffer_count;
+  int spilledp = 0;
+  if (input_as == input_labels) {
+    labels = Labels_new();
+  } else if (input_as == input_sparse_numbers) {
+    id_map = IdMap_new();
+  }
+  if (!(buffers = read_edges(input_file, input_as, thread_count, labels, id_map, &buffer_count))) {
+    if (labels != NULL) {
+      Labels_delete(labels);
+    }
+    if (id_map != NULL) {
+      IdMap_delete(id_map);
+    }
+    return NULL;
+  }
+  for (int i = 0; i < buffer_count; i++) {
+    if (buffers[i].max_vertex > max_vertex) {
+      max_vertex = buffers[i].max_vertex;
+    }
+    if (buffers[i].run_count > 0) {
+      spilledp = 1;
+    }
+  }
+  DBG("Creating digraph of " VFMT " vertices from %d edge buffers\n", max_vertex + 1, buffer_count);
+  if (spilledp) {
+    result = digraph_from_edge_runs(buffers, buffer_count, max_vertex + 1);
+  } else {
+    result = digraph_from_edge_buffers(buffers, buffer_count, max_vertex + 1);
+  }
+  result->labels = labels;
+  result->id_map = id_map;
+  for (int i = 0; i < buffer_count; i++) {
+    EdgeBuffer_delete(&(buffers[i]));
+  }
+  DELETE(buffers);
+  return result;
+}
+
+/* Reading a list of vertices of the digraph from a one-column csv file with a
+   header line. Returns the table of vertex ids and sets *count to their number. */
 
+vint *digraph_read_vertices(Digraph *this, char *input_file, vint *count) {
+  vint size = 1024;
+  vint *vertices = NEWN(vint, size);
+  vint line_number = 1;
+  char *line = NULL;
+  size_t line_size = 0;
+  ssize_t length;
   FILE *input;
-  if (input_file == NULL || !strcmp(input_file, "-")) {
-      input = stdin;
-  } else if (!(input = fopen(input_file, "r"))) {
-    fprintf(stderr, "Cannot open input file %s\n", input_file);
+  if (!(input = fopen(input_file, "r"))) {
+    fprintf(stderr, "Cannot open vertex file %s\n", input_file);
     exit(1);
   }
-
-  DBG("input: %ld\n", ftell(input));
-  if (fscanf(input, "%s\n", line1) != 1) {
-    fprintf(stderr, "Could not read line\n");
+  if (getline(&line, &line_size, input) < 0) {
+    fprintf(stderr, "Could not read the first line of vertex file %s\n", input_file);
     exit(1);
-  } else {
-    char *comma = strchr(line1, ',');
-    char *field1, *field2;
-    if (comma != NULL) {
-      field1 = line1;
-      *comma = (char)0;
-      field2 = comma + 1;
-      DBG("'%s', '%s'\n", field1, field2);
-    } else {
-      fprintf(stderr, "Could not read first line\n");
-      return NULL;
-    }
-  }
-  fgetpos(input, &second_line_start);
-  edge_count = 0;
-  char* linefmt = VFMT "," VFMT "\n";
-  while ((got = fscanf(input, linefmt, &from_vertex, &to_vertex)) == 2) {
-    DBG("Got 1 %d\n", got);
-    if (from_vertex < 0 || to_vertex < 0) {
-      fprintf(stderr, "Illegal edge " VFMT "," VFMT "!\n", from_vertex, to_vertex);
-      return NULL;
-    }
-    edge_count++;
-    DBG("edge_count = " VFMT "\n", edge_count);
-  }
-  DBG("Last got 1 %d\n", got);
-  if (!feof(input)) {
-    fprintf(stderr, VFMT " edges read, not at end of file, last got %d!\n", edge_count, got);
-    return NULL;
   }
-  DBG("Reading " VFMT " edges\n", edge_count);
-  edges = NEWN(EDGE, edge_count);
-  fsetpos(input, &second_line_start);
-  edge_index = 0;
-  max_vertex = 0;
-  while ((got = fscanf(input, linefmt, &(edges[edge_index].from), &(edges[edge_index].to)) == 2)) {
-    DBG("Got 2 %d\n", got);
-    if (edges[edge_index].from > max_vertex) {
-      max_vertex = edges[edge_index].from;
+  *count = 0;
+  while ((length = getline(&line, &line_size, input)) >= 0) {
+    line_number++;
+    char *field = line;
+    vint vertex_id;
+    length = trim_field(&field, length);
+    if (length == 0 || field[0] == '#') {
+      continue;
     }
-    if (edges[edge_index].to > max_vertex) {
-      max_vertex = edges[edge_index].to;
+    if (this->labels != NULL) {
+      vertex_id = Labels_find(this->labels, field, length);
+    } else if ((vertex_id = parse_number(field, length)) >= 0 && this->id_map != NULL) {
+      vertex_id = IdMap_find(this->id_map, vertex_id);
     }
-    edge_index++;
-    DBG("edge_index = " VFMT "\n", edge_index);
-  }
-  DBG("Last got 2 %d\n", got);
-  if (edge_index != edge_count) {
-    fprintf(stderr, "Something wrong " VFMT " == edge_index != edge_countedge_index != " VFMT "\n", edge_index, edge_count);
+    if (vertex_id < 0 || vertex_id >= this->vertex_count) {
+      fprintf(stderr, "Illegal vertex at line " VFMT " of vertex file %s: %.*s\n", line_number, input_file, (int)length, field);
+      exit(1);
+    }
+    if (*count == size) {
+      size *= 2;
+      vertices = (vint*)realloc(vertices, sizeof(vint)*size);
+    }
+    vertices[(*count)++] = vertex_id;
   }
+  free(line);
   fclose(input);
-  DBG("Sorting edges\n");
-  qsort((void*)edges, edge_count, sizeof(EDGE), &edge_cmp);
-  vertex_count = max_vertex + 1;
-  DBG("Creating " VFMT " vertex_table\n", vertex_count);
-  vertex_table =  NEWN(Vertex,vertex_count);
-  children = NEWN(vint, edge_count);
-  edge_index = 0;
+  return vertices;
+}
+
+/* ==== Reversing the edges of a digraph ==== */
+
+/* Create the transpose of the digraph: the edge (v,w) becomes (w,v). The transitive
+   closure of the transpose gives the predecessor sets of the original digraph. The
+   children tables are filled by a counting sort, so that this takes O(V+E) time. */
+Digraph *digraph_reverse(Digraph *this) {
+  vint vertex_count = this->vertex_count;
+  vint edge_count = this->edge_count;
+  Digraph *result = NEW(Digraph);
+  Vertex *vertex_table = NEWN(Vertex, vertex_count);
+  vint *children = NEWN(vint, edge_count);
+  vint *positions = new_vint_table(vertex_count, 0);
+  vint vi, ei, position;
+  for (vi = 0; vi < vertex_count; vi++) {
+    Vertex *v = &(this->vertex_table[vi]);
+    for (ei = 0; ei < v->outdegree; ei++) {
+      positions[v->children[ei]]++;
+    }
+  }
+  position = 0;
   for (vi = 0; vi < vertex_count; vi++) {
     vertex_table[vi].vertex_id = vi;
-    vertex_table[vi].children = children + edge_index;
-    vertex_table[vi].outdegree = 0;
-    while (edges[edge_index].from == vi) {
-      children[edge_index] = edges[edge_index].to;
-      vertex_table[vi].outdegree++;
-      edge_index++;
+    vertex_table[vi].outdegree = positions[vi];
+    vertex_table[vi].children = children + position;
+    positions[vi] = position;
+    position += vertex_table[vi].outdegree;
+  }
+  for (vi = 0; vi < vertex_count; vi++) {
+    Vertex *v = &(this->vertex_table[vi]);
+    for (ei = 0; ei < v->outdegree; ei++) {
+      children[positions[v->children[ei]]++] = vi;
     }
-    DBG("Vertex " VFMT ", " VFMT " edges\n", vi, vertex_table[vi].outdegree);
   }
-  result = NEW(Digraph);
+  DELETE(positions);
   result->vertex_count = vertex_count;
   result->edge_count = edge_count;
   result->edge_table = children;
   result->vertex_table = vertex_table;
+  result->reversep = !this->reversep;
+  result->labels = this->labels;
+  result->id_map = this->id_map;
+  return result;
+}
+
+/* ==== Relabeling the vertices for locality ==== */
+
+static char *relabel_order_names[] = {NULL, "dfs", "bfs"};
+
+/* Returns 0 for an unknown name */
+enum relabel_order relabel_order_from_name(char *name) {
+  for (int i = relabel_dfs; i <= relabel_bfs; i++) {
+    if (!strcmp(name, relabel_order_names[i])) {
+      return (enum relabel_order)i;
+    }
+  }
+  return 0;
+}
+
+/* Number the vertices in depth-first preorder, starting from the unnumbered
+   vertices in the order of their ids. This is the order in which stacktc
+   visits the vertices, so that the vertices of a search are near each other
+   in the vertex and edge tables. */
+static void dfs_order(Digraph *this, vint *new_ids) {
+  vint *vertex_stack = NEWN(vint, this->vertex_count);
+  vint *edge_stack = NEWN(vint, this->vertex_count);
+  vint next_id = 0;
+  for (vint root = 0; root < this->vertex_count; root++) {
+    if (new_ids[root] >= 0) {
+      continue;
+    }
+    vint top = 0;
+    new_ids[root] = next_id++;
+    vertex_stack[0] = root;
+    edge_stack[0] = 0;
+    while (top >= 0) {
+      Vertex *v = &(this->vertex_table[vertex_stack[top]]);
+      vint e = edge_stack[top];
+      /* The numbered children are skipped in a tight loop */
+      while (e < v->outdegree && new_ids[v->children[e]] >= 0) {
+	e++;
+      }
+      if (e == v->outdegree) {
+	top--;
+	continue;
+      }
+      vint child = v->children[e];
+      edge_stack[top] = e + 1;
+      new_ids[child] = next_id++;
+      top++;
+      vertex_stack[top] = child;
+      edge_stack[top] = 0;
+    }
+  }
+  DELETE(vertex_stack);
+  DELETE(edge_stack);
+}
+
+static int cmp_vertex_outdegree(const void *a, const void *b) {
+  Vertex *v = *(Vertex**)a;
+  Vertex *w = *(Vertex**)b;
+  if (v->outdegree != w->outdegree) {
+    return (v->outdegree < w->outdegree ? -1 : 1);
+  }
+  return (v->vertex_id < w->vertex_id ? -1 : v->vertex_id > w->vertex_id ? 1 : 0);
+}
+
+/* Number the vertices in breadth-first order, the new children of each vertex
+   by increasing outdegree as in the Cuthill-McKee ordering, starting from the
+   unnumbered vertices in the order of their ids. */
+static void bfs_order(Digraph *this, vint *new_ids) {
+  vint *queue = NEWN(vint, this->vertex_count);
+  Vertex **children = NEWN(Vertex*, this->vertex_count);
+  vint next_id = 0;
+  for (vint root = 0; root < this->vertex_count; root++) {
+    if (new_ids[root] >= 0) {
+      continue;
+    }
+    vint head = 0, tail = 0;
+    new_ids[root] = next_id++;
+    queue[tail++] = root;
+    while (head != tail) {
+      Vertex *v = &(this->vertex_table[queue[head++]]);
+      vint child_count = 0;
+      for (vint e = 0; e < v->outdegree; e++) {
+	vint child = v->children[e];
+	if (new_ids[child] < 0) {
+	  /* Marked here so that it is not collected twice */
+	  new_ids[child] = 0;
+	  children[child_count++] = &(this->vertex_table[child]);
+	}
+      }
+      qsort(children, child_count, sizeof(Vertex*), &cmp_vertex_outdegree);
+      for (vint c = 0; c < child_count; c++) {
+	new_ids[children[c]->vertex_id] = next_id++;
+	queue[tail++] = children[c]->vertex_id;
+      }
+    }
+  }
+  DELETE(queue);
+  DELETE(children);
+}
+
+/* Create a copy of the digraph with the vertices renumbered in the given
+   order, so that the vertices reached one after another in the search of
+   stacktc are near each other in memory. The labels or the id map of the
+   digraph are renumbered in place; for a digraph of plain numbers an id map is
+   created, so that the output uses the numbers of the input. */
+Digraph *digraph_relabel(Digraph *this, enum relabel_order order) {
+  vint vertex_count = this->vertex_count;
+  vint *new_ids = new_vint_table(vertex_count, -1);
+  vint *old_ids = NEWN(vint, vertex_count);
+  if (order == relabel_dfs) {
+    dfs_order(this, new_ids);
+  } else {
+    bfs_order(this, new_ids);
+  }
+  Digraph *result = NEW(Digraph);
+  Vertex *vertex_table = NEWN(Vertex, vertex_count);
+  vint *children = NEWN(vint, this->edge_count);
+  vint position = 0;
+  for (vint vi = 0; vi < vertex_count; vi++) {
+    old_ids[new_ids[vi]] = vi;
+    vertex_table[new_ids[vi]].outdegree = this->vertex_table[vi].outdegree;
+  }
+  for (vint vi = 0; vi < vertex_count; vi++) {
+    vertex_table[vi].vertex_id = vi;
+    vertex_table[vi].children = children + position;
+    position += vertex_table[vi].outdegree;
+  }
+  /* The children are copied in the old order of the vertices, so that only
+     the writes are scattered */
+  for (vint vi = 0; vi < vertex_count; vi++) {
+    Vertex *v = &(this->vertex_table[vi]);
+    vint *new_children = vertex_table[new_ids[vi]].children;
+    for (vint ei = 0; ei < v->outdegree; ei++) {
+      new_children[ei] = new_ids[v->children[ei]];
+    }
+  }
+  for (vint vi = 0; vi < vertex_count; vi++) {
+    qsort(vertex_table[vi].children, vertex_table[vi].outdegree, sizeof(vint), &cmp_vint);
+  }
+  result->vertex_count = vertex_count;
+  result->edge_count = this->edge_count;
+  result->edge_table = children;
+  result->vertex_table = vertex_table;
+  result->reversep = this->reversep;
+  result->labels = this->labels;
+  result->id_map = this->id_map;
+  if (result->labels != NULL) {
+    Assert(result->labels->label_count == vertex_count);
+    Labels_relabel(result->labels, new_ids);
+  } else if (result->id_map != NULL) {
+    Assert(result->id_map->id_count == vertex_count);
+    IdMap_relabel(result->id_map, new_ids);
+  } else {
+    result->id_map = IdMap_new();
+    for (vint vi = 0; vi < vertex_count; vi++) {
+      IdMap_intern(result->id_map, old_ids[vi]);
+    }
+  }
+  DELETE(new_ids);
+  DELETE(old_ids);
   return result;
 }
 
@@ -138,42 +425,39 @@ Digraph *tc_to_digraph(TC *tc) {
   vint scc_count = tc->scc_count;
   vint edge_count = 0;
   vint *edges;
-  vint i, j, k, l, m;
+  vint i, j, k;
   vint edge_index;
   vint *to_table = new_vint_table(vertex_count, -1);
   /* DBG("tc_to_digraph " VFMT " vertices " VFMT " components\n", vertex_count, scc_count); */
-  result->vertex_count = vertex_count;
-  result->vertex_table = NEWN(Vertex, vertex_count);
+  vint vertex_id_count = tc->vertex_id_count;
+  result->vertex_count = vertex_id_count;
+  result->vertex_table = NEWN(Vertex, vertex_id_count);
+  result->reversep = tc->reversep;
+  result->labels = tc->labels;
+  result->id_map = tc->id_map;
+  /* The vertices not reachable from the sources have no edges */
+  for (i = 0; i < vertex_id_count; i++) {
+    result->vertex_table[i].vertex_id = i;
+    result->vertex_table[i].outdegree = 0;
+    result->vertex_table[i].children = NULL;
+  }
   for (i = 0; i < scc_count; i++) {
-    edge_count += tc->scc_table[i]->vertex_count*SCC_successor_vertex_count(tc, i);
+    edge_count += TC_scc_vertex_count(tc, i)*SCC_successor_vertex_count(tc, i);
   }
   /* DBG(VFMT " edges in tc\n", edge_count); */
   edges = new_vint_table(edge_count, -1);
   result->edge_count = edge_count;
   edge_index = 0;
   for (i = 0; i < scc_count; i++) {
-    SCC *scc_from = tc->scc_table[i];
-    Intervals *succ = scc_from->successors;
-    vint to_table_index = 0;
-    if (succ != NULL) {
-      /* DBG("SCC " VFMT ", " VFMT " intervals\n", i, succ->interval_count); */
-      for (j = 0; j < succ->interval_count; j++) {
-	Interval *iv = &(succ->interval_table[j]);
-	for (l = iv->low; l <= iv->high; l++) {
-	  /* DBG("interval " VFMT ".." VFMT ", scc " VFMT "\n", iv->low, iv->high, l); */
-	  SCC *scc_to = tc->scc_table[l];
-	  for (m = 0; m < scc_to->vertex_count; m++) {
-	    /* DBG("copying edge to vertex " VFMT "\n", scc_to->vertex_table[m]); */
-	    to_table[to_table_index++] = scc_to->vertex_table[m];
-	  }
-	}
-      }
-    }
+    SCC scc_from = TC_scc_id_to_scc(tc, i);
+    TCVertexIter iter;
+    TCVertexIter_init(&iter, tc, i);
+    vint to_table_index = TCVertexIter_next(&iter, to_table, vertex_count);
     qsort(to_table, to_table_index, sizeof(vint), &cmp_vint);
-    for (j = 0; j < scc_from->vertex_count; j++) {
+    for (j = 0; j < scc_from.vertex_count; j++) {
       /* DBG("copying to edges[" VFMT ".." VFMT "]\n", edge_index, edge_index + to_table_index-1); */
       memcpy(edges+edge_index, to_table, to_table_index*sizeof(vint));
-      k = scc_from->vertex_table[j];
+      k = scc_from.vertex_table[j];
       result->vertex_table[k].vertex_id = k;
       result->vertex_table[k].outdegree = to_table_index;
       result->vertex_table[k].children = edges+edge_index;
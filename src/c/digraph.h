@@ -18,7 +18,14 @@
 #include "macros.h"
 #include "util.h"
 
-Digraph *digraph_read(char *input_file);
+Digraph *digraph_from_edge_buffers(EdgeBuffer *buffers, int buffer_count, vint vertex_count);
+Digraph *digraph_from_edges(EDGE *edges, vint edge_count, vint vertex_count);
+void digraph_delete(Digraph *this);
+Digraph *digraph_read(char *input_file, enum input_format input_as, int thread_count);
+vint *digraph_read_vertices(Digraph *this, char *input_file, vint *count);
+Digraph *digraph_reverse(Digraph *this);
+enum relabel_order relabel_order_from_name(char *name);
+Digraph *digraph_relabel(Digraph *this, enum relabel_order order);
 Digraph *tc_to_digraph(TC *tc);
 Matrix *digraph_to_matrix(Digraph *this);
 
@@ -0,0 +1,172 @@
+/*
+  =============================================================================
+  Author:  Esko Nuutila (enu@iki.fi)
+  Date:    2017-06-23
+  Date:    2022-07-12
+  Licence: MIT
+  =============================================================================
+  File: engines.c
+
+  Alternative algorithms for computing the same transitive closure as
+  stacktc, for comparing their performance. Each of them first finds the
+  strong components and the condensation graph by running stacktc in the
+  mode tc_condensation, and then computes the successor sets of the
+  components as interval sets:
+
+  bfs          A breadth-first search of the digraph from the root of each
+               component. This is the simple per-vertex search baseline
+               done once per component.
+  topological  The successor sets are computed from the condensation graph
+               in reverse topological order, that is, in the order of the
+               component ids, as in the methods of Purdom and others based
+               on the condensation graph.
+  warshall     Warshall's algorithm on a bit matrix of the components, 64
+               bits at a time. The memory needed is quadratic in the number
+               of components.
+  =============================================================================
+*/
+
+#include "engines.h"
+#include "algorithm.h"
+
+static char *algorithm_names[] = {NULL, "stacktc", "bfs", "topological", "warshall"};
+
+/* Returns 0 for an unknown name */
+enum tc_algorithm algorithm_from_name(char *name) {
+  for (int i = algorithm_stacktc; i <= algorithm_warshall; i++) {
+    if (!strcmp(name, algorithm_names[i])) {
+      return (enum tc_algorithm)i;
+    }
+  }
+  return 0;
+}
+
+/* A component is cyclic if it has several vertices or a self loop */
+int scc_cyclicp(Digraph *g, TC *tc, vint scc_id) {
+  if (TC_scc_vertex_count(tc, scc_id) > 1) {
+    return 1;
+  }
+  Vertex *vertex = &(g->vertex_table[TC_scc_root(tc, scc_id)]);
+  return bsearch(&(vertex->vertex_id), vertex->children, vertex->outdegree, sizeof(vint), &cmp_vint) != NULL;
+}
+
+/* ==== Breadth-first search from each component ==== */
+
+static void tc_bfs(Digraph *g, TC *tc) {
+  vint *queue = NEWN(vint, g->vertex_count);
+  vint *stamps = new_vint_table(g->vertex_count, -1);
+  for (vint i = 0; i < tc->scc_count; i++) {
+    Intervals *succ = Intervals_new();
+    vint head = 0, tail = 0;
+    queue[tail++] = TC_scc_root(tc, i);
+    while (head != tail) {
+      Vertex *vertex = &(g->vertex_table[queue[head++]]);
+      for (vint e = 0; e < vertex->outdegree; e++) {
+	vint child = vertex->children[e];
+	if (stamps[child] != i) {
+	  stamps[child] = i;
+	  queue[tail++] = child;
+	  Intervals_insert(succ, tc->vertex_id_to_scc_id_table[child]);
+	}
+      }
+    }
+    TC_set_successors(tc, i, succ);
+  }
+  DELETE(queue);
+  DELETE(stamps);
+}
+
+/* ==== Successor sets in reverse topological order ==== */
+
+static void tc_topological(Digraph *g, TC *tc) {
+  for (vint i = 0; i < tc->scc_count; i++) {
+    vint *adjacent_table = TC_scc_adjacent(tc, i);
+    Intervals *succ = Intervals_new();
+    /* The adjacent components are sorted; a component already in the set is
+       reachable from a larger one, and so are its successors */
+    for (vint j = TC_scc_adjacent_count(tc, i) - 1; j >= 0; j--) {
+      vint adjacent = adjacent_table[j];
+      if (!Intervals_insert(succ, adjacent)) {
+	Intervals successors = TC_scc_id_to_successor_set(tc, adjacent);
+	Intervals_union(succ, &successors);
+      }
+    }
+    if (scc_cyclicp(g, tc, i)) {
+      Intervals_insert(succ, i);
+    }
+    TC_set_successors(tc, i, succ);
+  }
+}
+
+/* ==== Bit-parallel Warshall ==== */
+
+#define WORD_BITS 64
+
+static void tc_warshall(Digraph *g, TC *tc) {
+  vint n = tc->scc_count;
+  vint words = (n + WORD_BITS - 1)/WORD_BITS;
+  unsigned long *matrix = calloc(n*words, sizeof(unsigned long));
+  if (matrix == NULL && n > 0) {
+    fprintf(stderr, "Not enough memory for a bit matrix of " VFMT " components\n", n);
+    exit(1);
+  }
+  for (vint i = 0; i < n; i++) {
+    vint *adjacent_table = TC_scc_adjacent(tc, i);
+    unsigned long *row = matrix + i*words;
+    for (vint j = 0; j < TC_scc_adjacent_count(tc, i); j++) {
+      vint adjacent = adjacent_table[j];
+      row[adjacent/WORD_BITS] |= 1UL << (adjacent % WORD_BITS);
+    }
+    if (scc_cyclicp(g, tc, i)) {
+      row[i/WORD_BITS] |= 1UL << (i % WORD_BITS);
+    }
+  }
+  for (vint k = 0; k < n; k++) {
+    unsigned long *row_k = matrix + k*words;
+    for (vint i = 0; i < n; i++) {
+      unsigned long *row_i = matrix + i*words;
+      if (i != k && (row_i[k/WORD_BITS] >> (k % WORD_BITS)) & 1) {
+	for (vint w = 0; w < words; w++) {
+	  row_i[w] |= row_k[w];
+	}
+      }
+    }
+  }
+  for (vint i = 0; i < n; i++) {
+    unsigned long *row = matrix + i*words;
+    Intervals *succ = Intervals_new();
+    for (vint w = 0; w < words; w++) {
+      for (unsigned long bits = row[w]; bits != 0; bits &= bits - 1) {
+	Intervals_insert(succ, w*WORD_BITS + __builtin_ctzl(bits));
+      }
+    }
+    TC_set_successors(tc, i, succ);
+  }
+  DELETE(matrix);
+}
+
+/* Compute the transitive closure using the given algorithm. The mode
+   tc_reduction is supported only by stacktc. */
+TC *tc_compute(Digraph *g, vint *sources, vint source_count, enum tc_mode mode, enum tc_algorithm algorithm) {
+  if (algorithm == algorithm_stacktc || mode == tc_condensation) {
+    return stacktc_sources(g, sources, source_count, mode);
+  }
+  Assert(mode == tc_closure);
+  TC *tc = stacktc_sources(g, sources, source_count, tc_condensation);
+  switch (algorithm) {
+  case algorithm_bfs:
+    tc_bfs(g, tc);
+    break;
+  case algorithm_topological:
+    tc_topological(g, tc);
+    break;
+  case algorithm_warshall:
+    tc_warshall(g, tc);
+    break;
+  default:
+    break;
+  }
+  /* The adjacent components are not part of the closure */
+  TC_delete_adjacent(tc);
+  return tc;
+}
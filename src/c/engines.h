@@ -0,0 +1,26 @@
+/*
+  =============================================================================
+  Author:  Esko Nuutila (enu@iki.fi)
+  Date:    2017-06-23
+  Date:    2022-07-12
+  Licence: MIT
+  =============================================================================
+  File: engines.h
+
+  Alternative algorithms for computing the same transitive closure as
+  stacktc, for comparing their performance.
+  =============================================================================
+*/
+
+#ifndef _engines_h_
+#define _engines_h_
+
+#include "types.h"
+#include "macros.h"
+#include "util.h"
+
+enum tc_algorithm algorithm_from_name(char *name);
+int scc_cyclicp(Digraph *g, TC *tc, vint scc_id);
+TC *tc_compute(Digraph *g, vint *sources, vint source_count, enum tc_mode mode, enum tc_algorithm algorithm);
+
+#endif
@@ -0,0 +1,216 @@
+/*
+  =============================================================================
+  Author:  Esko Nuutila (enu@iki.fi)
+  Date:    2017-06-23
+  Date:    2022-07-12
+  Licence: MIT
+  =============================================================================
+  File: estimate.c
+
+  Estimating the size of the transitive closure from the condensation graph
+  without computing the successor sets, so that the size of an output can be
+  known before computing it.
+
+  Each vertex gets a pseudo-random 64-bit hash value, and each component
+  keeps a k-min-values sketch of the vertices it reaches, including its own:
+  the k smallest hash values of the set. The sketch of a component is the
+  union of its own sketch and the sketches of its adjacent components, cut
+  to the k smallest values, so the sketches are computed in one pass in the
+  order of the component ids, that is, in reverse topological order. A
+  sketch is freed after its last use by a later component.
+
+  A set of n elements has the k-th smallest hash value near k/n of the range,
+  and (k-1)/h, where h is the k-th smallest value as a fraction of the
+  range, is an unbiased estimate of n. A set of fewer than k elements keeps
+  all of them in its sketch, so its size is exact.
+  =============================================================================
+*/
+
+#include "estimate.h"
+#include "tc.h"
+#include "engines.h"
+#include "labels.h"
+#include "idmap.h"
+#include <math.h>
+
+#define HASH_RANGE 18446744073709551616.0
+
+/* splitmix64 */
+static unsigned long vertex_hash(vint vertex_id) {
+  unsigned long z = (unsigned long)vertex_id + 0x9e3779b97f4a7c15UL;
+  z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9UL;
+  z = (z ^ (z >> 27))*0x94d049bb133111ebUL;
+  return z ^ (z >> 31);
+}
+
+static int cmp_hash(const void *a, const void *b) {
+  unsigned long x = *(unsigned long*)a, y = *(unsigned long*)b;
+  return (x < y ? -1 : x > y ? 1 : 0);
+}
+
+/* Merge the sorted sketch to the sorted sketch in result, keeping at most k
+   smallest distinct values. Buffer has room for k values. */
+static vint merge_sketch(unsigned long *result, vint count, unsigned long *other, vint other_count,
+			 unsigned long *buffer) {
+  vint i = 0, j = 0, n = 0;
+  while (n < ESTIMATE_SKETCH_SIZE && (i < count || j < other_count)) {
+    if (j == other_count || (i < count && result[i] < other[j])) {
+      buffer[n++] = result[i++];
+    } else if (i == count || other[j] < result[i]) {
+      buffer[n++] = other[j++];
+    } else {
+      buffer[n++] = result[i++];
+      j++;
+    }
+  }
+  memcpy(result, buffer, sizeof(unsigned long)*n);
+  return n;
+}
+
+static double sketch_estimate(unsigned long *sketch, vint count) {
+  if (count < ESTIMATE_SKETCH_SIZE) {
+    return (double)count;
+  }
+  return (ESTIMATE_SKETCH_SIZE - 1)/(sketch[count - 1]/HASH_RANGE);
+}
+
+/* The length of the vertex in the output */
+static vint vertex_length(TC *tc, vint vertex_id) {
+  char text[32];
+  if (tc->labels != NULL) {
+    return strlen(Labels_label(tc->labels, vertex_id));
+  }
+  vint number = (tc->id_map != NULL ? IdMap_original_id(tc->id_map, vertex_id) : vertex_id);
+  return snprintf(text, sizeof(text), VFMT, number);
+}
+
+/* The sizes of the outputs and the memory needed for computing the closure
+   exactly by stacktc, from the estimated sizes of the successor sets */
+static void estimate_sizes(ClosureEstimate *this, TC *tc, Digraph *g) {
+  double error = this->relative_error;
+  double vertex_length_sum = 0;
+  double interval_count = 0;
+  for (vint v = 0; v < tc->vertex_id_count; v++) {
+    if (TC_vertex_id_to_scc_id(tc, v) >= 0) {
+      vertex_length_sum += vertex_length(tc, v);
+    }
+  }
+  /* The lengths of the successors are estimated by the mean length */
+  double mean_length = (tc->vertex_count > 0 ? vertex_length_sum/tc->vertex_count : 0);
+  if (tc->labels != NULL) {
+    /* The quotes of the JSON strings */
+    mean_length += 2;
+  }
+  this->edge_count = this->edge_count_low = this->edge_count_high = 0;
+  /* The header line and the brackets of the list */
+  this->edges_bytes = strlen("from,to\n");
+  this->vertices_bytes = strlen("[\n]\n");
+  for (vint i = 0; i < tc->scc_count; i++) {
+    double successors = this->successor_count_table[i];
+    vint vertex_count = TC_scc_vertex_count(tc, i);
+    vint *vertices = TC_scc_vertices(tc, i);
+    double low = successors, high = successors;
+    if (!this->exact_table[i]) {
+      low = successors*(1 - error);
+      high = successors*(1 + error);
+    }
+    this->edge_count += vertex_count*successors;
+    this->edge_count_low += vertex_count*low;
+    this->edge_count_high += vertex_count*high;
+    for (vint j = 0; j < vertex_count; j++) {
+      vint length = vertex_length(tc, vertices[j]);
+      /* FROM,TO and a newline */
+      this->edges_bytes += successors*(length + mean_length + 2);
+      /* The JSON object of the vertex and its list of successors */
+      this->vertices_bytes += 54 + length + successors*(mean_length + 2) - (successors > 0 ? 2 : 0);
+    }
+    /* Each interval has at least one component */
+    interval_count += (high < tc->scc_count ? high : tc->scc_count);
+  }
+  /* The digraph, the tables of the closure, the working tables of stacktc
+     and the swap buffers of the interval sets. The number of intervals
+     depends on the numbering of the components and cannot be estimated
+     from the sketches, so the upper bound counts one interval for each
+     successor component and no sharing of identical sets. */
+  vint n = g->vertex_count;
+  this->memory_bytes_low = sizeof(Vertex)*(double)n + sizeof(vint)*(double)g->edge_count
+    + 9*sizeof(vint)*(double)n
+    + 3*sizeof(vint)*(double)n + sizeof(vint)*(double)(g->edge_count + n)
+    + 2*sizeof(Interval)*(double)(n/2 + 1);
+  this->memory_bytes_high = this->memory_bytes_low + sizeof(Interval)*interval_count;
+}
+
+/* Estimate the sizes of the successor sets of the components of a closure
+   computed in the mode tc_condensation from the digraph g */
+ClosureEstimate *estimate_closure(TC *tc, Digraph *g) {
+  vint scc_count = tc->scc_count;
+  ClosureEstimate *this = NEW(ClosureEstimate);
+  this->sketch_size = ESTIMATE_SKETCH_SIZE;
+  /* About 95% of the estimates are within two standard errors */
+  this->relative_error = 2/sqrt(ESTIMATE_SKETCH_SIZE - 2);
+  this->successor_count_table = NEWN(double, scc_count);
+  this->exact_table = NEWN(int, scc_count);
+  unsigned long **sketch_table = NEWN(unsigned long*, scc_count);
+  vint *sketch_count_table = NEWN(vint, scc_count);
+  /* The last component using the sketch of each component */
+  vint *last_use_table = new_vint_table(scc_count, -1);
+  unsigned long *own = NULL;
+  vint own_size = 0;
+  unsigned long *successors = NEWN(unsigned long, ESTIMATE_SKETCH_SIZE);
+  unsigned long *buffer = NEWN(unsigned long, ESTIMATE_SKETCH_SIZE);
+  for (vint i = 0; i < scc_count; i++) {
+    vint *adjacent = TC_scc_adjacent(tc, i);
+    for (vint j = 0; j < TC_scc_adjacent_count(tc, i); j++) {
+      last_use_table[adjacent[j]] = i;
+    }
+  }
+  for (vint i = 0; i < scc_count; i++) {
+    vint vertex_count = TC_scc_vertex_count(tc, i);
+    vint *vertices = TC_scc_vertices(tc, i);
+    if (vertex_count > own_size) {
+      DELETE(own);
+      own_size = 2*vertex_count;
+      own = NEWN(unsigned long, own_size);
+    }
+    for (vint j = 0; j < vertex_count; j++) {
+      own[j] = vertex_hash(vertices[j]);
+    }
+    qsort(own, vertex_count, sizeof(unsigned long), &cmp_hash);
+    vint own_count = (vertex_count < ESTIMATE_SKETCH_SIZE ? vertex_count : ESTIMATE_SKETCH_SIZE);
+    vint count = 0;
+    vint *adjacent = TC_scc_adjacent(tc, i);
+    for (vint j = 0; j < TC_scc_adjacent_count(tc, i); j++) {
+      vint a = adjacent[j];
+      count = merge_sketch(successors, count, sketch_table[a], sketch_count_table[a], buffer);
+      if (last_use_table[a] == i) {
+	DELETE(sketch_table[a]);
+      }
+    }
+    /* A cyclic component is its own successor */
+    if (scc_cyclicp(g, tc, i)) {
+      count = merge_sketch(successors, count, own, own_count, buffer);
+    }
+    this->successor_count_table[i] = sketch_estimate(successors, count);
+    this->exact_table[i] = (count < ESTIMATE_SKETCH_SIZE);
+    if (last_use_table[i] >= 0) {
+      count = merge_sketch(successors, count, own, own_count, buffer);
+      sketch_table[i] = NEWN(unsigned long, count);
+      memcpy(sketch_table[i], successors, sizeof(unsigned long)*count);
+      sketch_count_table[i] = count;
+    }
+  }
+  DELETE(own);
+  DELETE(successors);
+  DELETE(buffer);
+  DELETE(sketch_table);
+  DELETE(sketch_count_table);
+  DELETE(last_use_table);
+  estimate_sizes(this, tc, g);
+  return this;
+}
+
+void ClosureEstimate_delete(ClosureEstimate *this) {
+  DELETE(this->successor_count_table);
+  DELETE(this->exact_table);
+  DELETE(this);
+}
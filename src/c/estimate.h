@@ -0,0 +1,29 @@
+/*
+  =============================================================================
+  Author:  Esko Nuutila (enu@iki.fi)
+  Date:    2017-06-23
+  Date:    2022-07-12
+  Licence: MIT
+  =============================================================================
+  File: estimate.h
+
+  Estimating the size of the transitive closure from the condensation graph
+  without computing the successor sets.
+  =============================================================================
+*/
+
+#ifndef _estimate_h_
+#define _estimate_h_
+
+#include "types.h"
+#include "macros.h"
+#include "util.h"
+
+/* The number of smallest hash values kept for each component. The relative
+   standard error of an estimated size is 1/sqrt(ESTIMATE_SKETCH_SIZE-2). */
+#define ESTIMATE_SKETCH_SIZE 256
+
+ClosureEstimate *estimate_closure(TC *tc, Digraph *g);
+void ClosureEstimate_delete(ClosureEstimate *this);
+
+#endif
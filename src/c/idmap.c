@@ -0,0 +1,110 @@
+/*
+  =============================================================================
+  Author:  Esko Nuutila (enu@iki.fi)
+  Date:    2017-06-23
+  Date:    2022-07-12
+  Licence: MIT
+  =============================================================================
+  File: idmap.c
+
+  Mapping sparse vertex ids to dense vertex ids and back.
+  =============================================================================
+*/
+
+#include "idmap.h"
+
+#define IDMAP_INITIAL_HASH_SIZE 1024
+
+/* Fibonacci hashing; the high bits are folded to the low bits used as the index */
+static unsigned long id_hash(vint original_id) {
+  unsigned long hash = (unsigned long)original_id * 11400714819323198485UL;
+  return hash ^ (hash >> 32);
+}
+
+IdMap *IdMap_new() {
+  IdMap *this = NEW(IdMap);
+  this->hash_size = IDMAP_INITIAL_HASH_SIZE;
+  this->hash_table = new_vint_table(this->hash_size, -1);
+  this->id_size = IDMAP_INITIAL_HASH_SIZE/2;
+  this->original_ids = NEWN(vint, this->id_size);
+  this->id_count = 0;
+  return this;
+}
+
+void IdMap_delete(IdMap *this) {
+  DELETE(this->hash_table);
+  DELETE(this->original_ids);
+  DELETE(this);
+}
+
+static void IdMap_grow_hash_table(IdMap *this) {
+  vint hash_size = this->hash_size*2;
+  vint *hash_table = new_vint_table(hash_size, -1);
+  for (vint id = 0; id < this->id_count; id++) {
+    vint i = (vint)(id_hash(this->original_ids[id]) & (hash_size - 1));
+    while (hash_table[i] >= 0) {
+      i = (i + 1) & (hash_size - 1);
+    }
+    hash_table[i] = id;
+  }
+  DELETE(this->hash_table);
+  this->hash_table = hash_table;
+  this->hash_size = hash_size;
+}
+
+/* Return the position of the id in the hash table; either the slot
+   containing its dense id or the empty slot where it should be put. */
+static vint IdMap_slot(IdMap *this, vint original_id) {
+  vint mask = this->hash_size - 1;
+  vint i = (vint)(id_hash(original_id) & mask);
+  vint id;
+  while ((id = this->hash_table[i]) >= 0 && this->original_ids[id] != original_id) {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+/* Return the dense id of the id, assigning the next free dense id to a new id */
+vint IdMap_intern(IdMap *this, vint original_id) {
+  vint i = IdMap_slot(this, original_id);
+  if (this->hash_table[i] >= 0) {
+    return this->hash_table[i];
+  }
+  vint id = this->id_count++;
+  if (id == this->id_size) {
+    this->id_size *= 2;
+    this->original_ids = (vint*)realloc(this->original_ids, sizeof(vint)*this->id_size);
+  }
+  this->original_ids[id] = original_id;
+  this->hash_table[i] = id;
+  /* Keep the load factor at most 1/2 */
+  if (2*this->id_count > this->hash_size) {
+    IdMap_grow_hash_table(this);
+  }
+  return id;
+}
+
+/* Return the dense id of the id or -1 if it has not been interned */
+vint IdMap_find(IdMap *this, vint original_id) {
+  return this->hash_table[IdMap_slot(this, original_id)];
+}
+
+vint IdMap_original_id(IdMap *this, vint vertex_id) {
+  return this->original_ids[vertex_id];
+}
+
+/* Renumber the dense ids: the id i becomes new_ids[i]. The new ids must be
+   a permutation of the old ones. */
+void IdMap_relabel(IdMap *this, vint *new_ids) {
+  vint *original_ids = NEWN(vint, this->id_size);
+  for (vint id = 0; id < this->id_count; id++) {
+    original_ids[new_ids[id]] = this->original_ids[id];
+  }
+  for (vint i = 0; i < this->hash_size; i++) {
+    if (this->hash_table[i] >= 0) {
+      this->hash_table[i] = new_ids[this->hash_table[i]];
+    }
+  }
+  DELETE(this->original_ids);
+  this->original_ids = original_ids;
+}
@@ -0,0 +1,34 @@
+/*
+  =============================================================================
+  Author:  Esko Nuutila (enu@iki.fi)
+  Date:    2017-06-23
+  Date:    2022-07-12
+  Licence: MIT
+  =============================================================================
+  File: idmap.h
+
+  Mapping sparse vertex ids to dense vertex ids and back.
+
+  Each distinct id in the input gets the next free dense id 0, 1, ... The
+  dense ids are found using an open addressing hash table with linear
+  probing, and the table original_ids maps them back to the input ids.
+  Thus the memory needed depends on the number of distinct vertices and not
+  on the largest vertex id.
+  =============================================================================
+*/
+
+#ifndef _idmap_h_
+#define _idmap_h_
+
+#include "types.h"
+#include "macros.h"
+#include "util.h"
+
+IdMap *IdMap_new();
+void IdMap_delete(IdMap *this);
+vint IdMap_intern(IdMap *this, vint original_id);
+vint IdMap_find(IdMap *this, vint original_id);
+vint IdMap_original_id(IdMap *this, vint vertex_id);
+void IdMap_relabel(IdMap *this, vint *new_ids);
+
+#endif
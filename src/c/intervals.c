@@ -28,17 +28,98 @@
 
   WARNING! This implementation is optimized just for the stack_tc algorithm.
   For other uses you should change the memory management.
+
+  The completed interval tables of a closure are copied one after another
+  to the growing chunks of an interval store, and they are all freed with
+  the store. If the closure does not fit in memory, the chunks can be
+  spilled to a log file after a memory budget has been used. The file is
+  mapped to memory in large segments, so a spilled table is used through a
+  pointer like any other, and the kernel keeps the recently used pages in
+  memory and writes the others to the disk.
+
+  Many components often have identical successor sets, for example all the
+  components whose only successor is the same leaf. When a set is completed,
+  it is looked up by its contents from the sets completed earlier in the same
+  closure, and the table of an identical set is shared instead of copied.
+  If only few of the sets turn out to be identical,
+  the sharing is stopped for the rest of the closure, as the hash table would
+  then use more memory than it saves.
+
+  A completed set can be copied to a read-only layout for point lookups,
+  where the intervals are in the Eytzinger order of a binary tree. The
+  search descends without branches and prefetches the nodes three levels
+  ahead, so that a lookup in a large set does not wait for each cache miss
+  in turn.
   =============================================================================
 */
 
 #include "intervals.h"
+#include <unistd.h>
+#include <sys/mman.h>
+
+/* The swap buffers and the log are per thread */
+__thread Interval *interval_table_from = 0;
+__thread Interval *interval_table_to = 0;
+__thread vint max_interval_count = 0;
+__thread IntervalLog *interval_log = NULL;
+
+/* The completed sets of the closure being computed, hashed by their contents */
+typedef struct shared_set_struct {
+  Interval *interval_table; /* NULL for an empty slot */
+  vint interval_count;
+  unsigned long hash;
+} SharedSet;
 
-Interval *interval_table_from = 0;
-Interval *interval_table_to = 0;
+__thread SharedSet *shared_set_table = NULL;
+__thread vint shared_set_size = 0; /* Always a power of two */
+__thread vint shared_set_count = 0;
+__thread vint shared_set_hits = 0; /* The completed sets that were shared */
 
+static void reset_shared_sets() {
+  if (shared_set_size != INTERVALS_SHARED_INITIAL_SIZE) {
+    DELETE(shared_set_table);
+    shared_set_size = INTERVALS_SHARED_INITIAL_SIZE;
+    shared_set_table = NEWN(SharedSet, shared_set_size);
+  }
+  memset(shared_set_table, 0, sizeof(SharedSet)*shared_set_size);
+  shared_set_count = shared_set_hits = 0;
+}
+
+/* Stop looking for identical sets in this closure */
+static void stop_sharing() {
+  DELETE(shared_set_table);
+  shared_set_table = NULL;
+  shared_set_size = 0;
+}
+
+/* Make the swap buffers of this thread large enough for sets of ids less
+   than max_ids. The buffers are grown when needed and kept until
+   Intervals_finalize_tc. */
+void Intervals_reserve(vint max_ids) {
+  if (max_ids/2+1 > max_interval_count) {
+    DELETE(interval_table_to);
+    DELETE(interval_table_from);
+    max_interval_count = max_ids/2+1;
+    interval_table_to = NEWN(Interval, max_interval_count);
+    interval_table_from = NEWN(Interval, max_interval_count);
+  }
+}
+
+/* Prepare for computing a new closure. The sets of the previous closure
+   are no longer shared with the new ones. */
 void Intervals_initialize_tc(vint max_ids) {
-  interval_table_to = NEWN(Interval, max_ids/2+1);
-  interval_table_from = NEWN(Interval, max_ids/2+1);
+  Intervals_reserve(max_ids);
+  reset_shared_sets();
+}
+
+/* Free the buffers allocated by Intervals_initialize_tc and stop spilling */
+void Intervals_finalize_tc() {
+  DELETE(interval_table_to);
+  DELETE(interval_table_from);
+  interval_table_to = interval_table_from = 0;
+  max_interval_count = 0;
+  stop_sharing();
+  Intervals_close_spill();
 }
 
 /* Create a new interval set. */
@@ -49,12 +130,231 @@ Intervals *Intervals_new() {
   return this;
 }
 
-/* This function is needed because of the storage method used */
-void Intervals_completed(Intervals *this) {
+/* Free an interval set that has a table of its own, see Intervals_from_sorted */
+void Intervals_delete(Intervals *this) {
+  DELETE(this->interval_table);
+  DELETE(this);
+}
+
+/* ==== Spilling to a log file ==== */
+
+/* Spill the chunks of the interval stores of the closures computed in this
+   thread to an unnamed file in the directory after memory_budget bytes of
+   them are in memory. Returns 0 if the file cannot be created. */
+int Intervals_spill_to(char *directory, size_t memory_budget) {
+  Intervals_close_spill();
+  size_t length = strlen(directory);
+  char *path = NEWN(char, length + sizeof("/stacktc-XXXXXX"));
+  sprintf(path, "%s/stacktc-XXXXXX", directory);
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    DELETE(path);
+    return 0;
+  }
+  /* The file is removed when it is closed */
+  unlink(path);
+  DELETE(path);
+  interval_log = NEW(IntervalLog);
+  interval_log->fd = fd;
+  interval_log->file_size = 0;
+  interval_log->memory_budget = memory_budget;
+  interval_log->memory_used = 0;
+  return 1;
+}
+
+/* Stop spilling in this thread and close the log file. The chunks already
+   mapped stay valid and are unmapped when their interval stores are
+   deleted; the file is removed after that. */
+void Intervals_close_spill() {
+  if (interval_log != NULL) {
+    close(interval_log->fd);
+    DELETE(interval_log);
+    interval_log = NULL;
+  }
+}
+
+/* Add a new segment of the given size to the end of the file and map it.
+   The segment is rounded up to whole pages, so that the offset of the next
+   one is page aligned as mmap requires. */
+static Interval *IntervalLog_map_segment(IntervalLog *this, size_t bytes) {
+  Interval *segment;
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  bytes = (bytes + page_size - 1)/page_size*page_size;
+  if (ftruncate(this->fd, this->file_size + bytes) != 0
+      || (segment = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, this->file_size)) == MAP_FAILED) {
+    perror("Cannot extend the interval log file");
+    exit(1);
+  }
+  this->file_size += bytes;
+  return segment;
+}
+
+/* ==== Storing the completed sets ==== */
+
+IntervalStore *IntervalStore_new() {
+  IntervalStore *this = NEW(IntervalStore);
+  this->chunk_table = NULL;
+  this->chunk_size_table = NULL;
+  this->chunk_mapped_table = NULL;
+  this->chunk_count = 0;
+  this->chunk_used = 0;
+  return this;
+}
+
+/* The mapped chunks are unmapped, but their space in the log file is not
+   reused. */
+void IntervalStore_delete(IntervalStore *this) {
+  for (vint i = 0; i < this->chunk_count; i++) {
+    size_t bytes = sizeof(Interval)*this->chunk_size_table[i];
+    if (this->chunk_mapped_table[i]) {
+      munmap(this->chunk_table[i], bytes);
+    } else {
+      DELETE(this->chunk_table[i]);
+      if (interval_log != NULL) {
+	interval_log->memory_used -= bytes;
+      }
+    }
+  }
+  DELETE(this->chunk_table);
+  DELETE(this->chunk_size_table);
+  DELETE(this->chunk_mapped_table);
+  DELETE(this);
+}
+
+/* Add a new chunk. The chunks grow up to INTERVALS_CHUNK_MAX_SIZE, and each
+   is large enough for the largest interval table, so that no table is
+   split. After the memory budget has been used, the chunks are mapped from
+   the log file. */
+static void IntervalStore_add_chunk(IntervalStore *this) {
+  vint chunk_size = (this->chunk_count == 0 ? INTERVALS_CHUNK_MIN_SIZE
+		     : 2*this->chunk_size_table[this->chunk_count - 1]);
+  if (chunk_size > INTERVALS_CHUNK_MAX_SIZE) {
+    chunk_size = INTERVALS_CHUNK_MAX_SIZE;
+  }
+  if (chunk_size < max_interval_count) {
+    chunk_size = max_interval_count;
+  }
+  size_t bytes = sizeof(Interval)*chunk_size;
+  int mappedp = (interval_log != NULL && interval_log->memory_used + bytes > interval_log->memory_budget);
+  Interval *chunk;
+  if (mappedp) {
+    /* Larger chunks for fewer mappings */
+    if (chunk_size < (vint)(INTERVALS_LOG_SEGMENT_SIZE/sizeof(Interval))) {
+      chunk_size = INTERVALS_LOG_SEGMENT_SIZE/sizeof(Interval);
+      bytes = sizeof(Interval)*chunk_size;
+    }
+    chunk = IntervalLog_map_segment(interval_log, bytes);
+  } else {
+    chunk = NEWN(Interval, chunk_size);
+    if (interval_log != NULL) {
+      interval_log->memory_used += bytes;
+    }
+  }
+  vint n = this->chunk_count + 1;
+  this->chunk_table = realloc(this->chunk_table, sizeof(Interval*)*n);
+  this->chunk_size_table = realloc(this->chunk_size_table, sizeof(vint)*n);
+  this->chunk_mapped_table = realloc(this->chunk_mapped_table, sizeof(int)*n);
+  this->chunk_table[this->chunk_count] = chunk;
+  this->chunk_size_table[this->chunk_count] = chunk_size;
+  this->chunk_mapped_table[this->chunk_count] = mappedp;
+  this->chunk_count = n;
+  this->chunk_used = 0;
+}
+
+/* Copy the table to the end of the last chunk */
+static Interval *IntervalStore_append(IntervalStore *this, Interval *table, vint count) {
+  if (this->chunk_count == 0 || this->chunk_used + count > this->chunk_size_table[this->chunk_count - 1]) {
+    IntervalStore_add_chunk(this);
+  }
+  Interval *result = this->chunk_table[this->chunk_count - 1] + this->chunk_used;
+  memcpy(result, table, sizeof(Interval)*count);
+  this->chunk_used += count;
+  return result;
+}
+
+/* ==== Sharing identical sets ==== */
+
+static unsigned long hash_intervals(Interval *table, vint count) {
+  unsigned long hash = 14695981039346656037UL ^ (unsigned long)count;
+  for (vint i = 0; i < count; i++) {
+    hash = (hash ^ (unsigned long)table[i].low)*1099511628211UL;
+    hash = (hash ^ (unsigned long)table[i].high)*1099511628211UL;
+  }
+  return hash ^ (hash >> 29);
+}
+
+/* The slot of the set with the same contents as the table, or the empty
+   slot where it should be put */
+static SharedSet *find_shared_set(Interval *table, vint count, unsigned long hash) {
+  vint mask = shared_set_size - 1;
+  vint slot = (vint)(hash & mask);
+  SharedSet *set;
+  while ((set = &(shared_set_table[slot]))->interval_table != NULL) {
+    if (set->hash == hash && set->interval_count == count
+	&& !memcmp(set->interval_table, table, sizeof(Interval)*count)) {
+      break;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return set;
+}
+
+/* Double the hash table when it becomes half full */
+static void grow_shared_sets() {
+  SharedSet *old_sets = shared_set_table;
+  vint old_size = shared_set_size;
+  shared_set_size *= 2;
+  shared_set_table = NEWN(SharedSet, shared_set_size);
+  memset(shared_set_table, 0, sizeof(SharedSet)*shared_set_size);
+  vint mask = shared_set_size - 1;
+  for (vint i = 0; i < old_size; i++) {
+    if (old_sets[i].interval_table != NULL) {
+      vint slot = (vint)(old_sets[i].hash & mask);
+      while (shared_set_table[slot].interval_table != NULL) {
+	slot = (slot + 1) & mask;
+      }
+      shared_set_table[slot] = old_sets[i];
+    }
+  }
+  DELETE(old_sets);
+}
+
+/* This function is needed because of the storage method used. The open set
+   is copied to the store, or if an identical set has already been
+   completed, its table is shared. Returns the completed table, which is
+   valid until the store is deleted. The set itself is freed. */
+Interval *Intervals_completed(Intervals *this, IntervalStore *store) {
   Assert(this->interval_table == interval_table_from);
-  Interval *ins = NEWN(Interval, this->interval_count);
-  memcpy(ins, this->interval_table, sizeof(Interval)*this->interval_count);
-  this->interval_table = ins;
+  Interval *table = this->interval_table;
+  vint count = this->interval_count;
+  DELETE(this);
+  SharedSet *shared = NULL;
+  unsigned long hash = 0;
+  if (shared_set_table != NULL) {
+    hash = hash_intervals(table, count);
+    shared = find_shared_set(table, count, hash);
+    if (shared->interval_table != NULL) {
+      shared_set_hits++;
+      return shared->interval_table;
+    }
+  }
+  Interval *result = IntervalStore_append(store, table, count);
+  if (shared == NULL) {
+    return result;
+  }
+  shared->interval_table = result;
+  shared->interval_count = count;
+  shared->hash = hash;
+  if (2*(++shared_set_count) > shared_set_size) {
+    /* The table would only cost memory if there are few identical sets */
+    if (shared_set_count >= INTERVALS_SHARED_TRIAL_COUNT
+	&& shared_set_hits < shared_set_count/INTERVALS_SHARED_MIN_RATIO) {
+      stop_sharing();
+    } else {
+      grow_shared_sets();
+    }
+  }
+  return result;
 }
 
 /* Inserting a number to an interval set. This may extend an existing interval,
@@ -210,6 +510,147 @@ void Intervals_union(Intervals *this, Intervals *other) {
   this->interval_count = i;
 }
 
+/* A completed interval set of sorted ids, which may contain duplicates */
+Intervals *Intervals_from_sorted(vint *ids, vint count) {
+  Intervals *this = NEW(Intervals);
+  Interval *ins = this->interval_table = NEWN(Interval, count);
+  vint n = 0;
+  for (vint i = 0; i < count; i++) {
+    if (n > 0 && ids[i] <= ins[n-1].high + 1) {
+      ins[n-1].high = ids[i];
+    } else {
+      ins[n].low = ins[n].high = ids[i];
+      n++;
+    }
+  }
+  this->interval_count = n;
+  return this;
+}
+
+/* The next intervals of the sets in Intervals_union_all */
+typedef struct interval_cursor_struct {
+  Interval *next;
+  Interval *limit;
+} IntervalCursor;
+
+static void sift_down(IntervalCursor *heap, vint count, vint i) {
+  IntervalCursor cursor = heap[i];
+  while (2*i + 1 < count) {
+    vint child = 2*i + 1;
+    if (child + 1 < count && heap[child + 1].next->low < heap[child].next->low) {
+      child++;
+    }
+    if (cursor.next->low <= heap[child].next->low) {
+      break;
+    }
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = cursor;
+}
+
+/* The union of this and several other interval sets. All the sets are
+   merged at the same time using a heap of their next intervals, so that
+   the time is O(n log k) for n intervals in k sets instead of O(n k) for
+   unioning them one at a time. */
+void Intervals_union_all(Intervals *this, Intervals *others, vint other_count) {
+  IntervalCursor *heap = NEWN(IntervalCursor, (other_count + 1));
+  vint heap_count = 0;
+  for (vint i = -1; i < other_count; i++) {
+    Intervals *set = (i < 0 ? this : &(others[i]));
+    if (set->interval_count > 0) {
+      heap[heap_count].next = set->interval_table;
+      heap[heap_count].limit = set->interval_table + set->interval_count;
+      heap_count++;
+    }
+  }
+  for (vint i = heap_count/2 - 1; i >= 0; i--) {
+    sift_down(heap, heap_count, i);
+  }
+  Interval *result = interval_table_to;
+  vint n = 0;
+  while (heap_count > 0) {
+    Interval *next = heap[0].next++;
+    if (n > 0 && next->low <= result[n-1].high + 1) {
+      if (next->high > result[n-1].high) {
+	result[n-1].high = next->high;
+      }
+    } else {
+      result[n++] = *next;
+    }
+    if (heap[0].next == heap[0].limit) {
+      heap[0] = heap[--heap_count];
+    }
+    if (heap_count > 0) {
+      sift_down(heap, heap_count, 0);
+    }
+  }
+  DELETE(heap);
+  interval_table_to = this->interval_table;
+  this->interval_table = interval_table_from = result;
+  this->interval_count = n;
+}
+
+/* The intersection of two interval sets */
+void Intervals_intersection(Intervals *this, Intervals *other) {
+  Interval *result = interval_table_to;
+  Interval *ins1 = this->interval_table;
+  vint i1 = 0, i2 = 0, i = 0;
+  vint max1 = this->interval_count;
+  vint max2 = (other != NULL ? other->interval_count : 0);
+  while (i1 < max1 && i2 < max2) {
+    Interval *a = &(ins1[i1]), *b = &(other->interval_table[i2]);
+    vint low = (a->low > b->low ? a->low : b->low);
+    vint high = (a->high < b->high ? a->high : b->high);
+    if (low <= high) {
+      result[i].low = low;
+      result[i++].high = high;
+    }
+    /* The interval ending first cannot overlap anything after the other */
+    if (a->high < b->high) {
+      i1++;
+    } else {
+      i2++;
+    }
+  }
+  interval_table_to = ins1;
+  this->interval_table = interval_table_from = result;
+  this->interval_count = i;
+}
+
+/* The difference of two interval sets: the numbers of this not in other */
+void Intervals_difference(Intervals *this, Intervals *other) {
+  Interval *result = interval_table_to;
+  Interval *ins1 = this->interval_table;
+  vint i2 = 0, i = 0;
+  vint max1 = this->interval_count;
+  vint max2 = (other != NULL ? other->interval_count : 0);
+  for (vint i1 = 0; i1 < max1; i1++) {
+    vint low = ins1[i1].low, high = ins1[i1].high;
+    /* Skip the intervals of other before this one */
+    while (i2 < max2 && other->interval_table[i2].high < low) {
+      i2++;
+    }
+    /* Cut away the intervals of other overlapping this one */
+    vint j = i2;
+    while (j < max2 && other->interval_table[j].low <= high) {
+      if (other->interval_table[j].low > low) {
+	result[i].low = low;
+	result[i++].high = other->interval_table[j].low - 1;
+      }
+      low = other->interval_table[j].high + 1;
+      j++;
+    }
+    if (low <= high) {
+      result[i].low = low;
+      result[i++].high = high;
+    }
+  }
+  interval_table_to = ins1;
+  this->interval_table = interval_table_from = result;
+  this->interval_count = i;
+}
+
 /* Find a number in an interval set */
 vint Intervals_find(Intervals *this, vint id) {
   vint min = 0;
@@ -227,3 +668,55 @@ vint Intervals_find(Intervals *this, vint id) {
   }
   return 0;
 }
+
+/* ==== The lookup layout of completed sets ==== */
+
+#define SEARCH_LINE_SIZE 64
+
+static vint *new_search_table(vint count) {
+  size_t bytes = sizeof(vint)*(count + 1);
+  bytes = (bytes + SEARCH_LINE_SIZE - 1)/SEARCH_LINE_SIZE*SEARCH_LINE_SIZE;
+  return (vint*)aligned_alloc(SEARCH_LINE_SIZE, bytes);
+}
+
+/* Fill the subtree at node k with the intervals from *next on in order */
+static void fill_search(IntervalSearch *this, Interval *table, vint *next, vint k) {
+  if (k <= this->interval_count) {
+    fill_search(this, table, next, 2*k);
+    this->low_table[k] = table[*next].low;
+    this->high_table[k] = table[*next].high;
+    (*next)++;
+    fill_search(this, table, next, 2*k + 1);
+  }
+}
+
+/* Copy the intervals of a completed table to the Eytzinger order, where the
+   children of node k are 2k and 2k+1. The top levels of the tree are at the
+   start of the table and stay in the cache, and the nodes three levels below
+   node k are in the same cache line, so that they can be prefetched. */
+void IntervalSearch_build(IntervalSearch *this, Interval *table, vint count) {
+  vint next = 0;
+  this->interval_count = count;
+  this->low_table = new_search_table(count);
+  this->high_table = new_search_table(count);
+  fill_search(this, table, &next, 1);
+}
+
+void IntervalSearch_free(IntervalSearch *this) {
+  DELETE(this->low_table);
+  DELETE(this->high_table);
+}
+
+/* The same as Intervals_find. The descent does not branch on the comparison:
+   the path is recorded in the bits of k, and the last interval with low <= id
+   is the node where the path last went right. */
+vint IntervalSearch_find(IntervalSearch *this, vint id) {
+  vint *low = this->low_table;
+  vint k = 1;
+  while (k <= this->interval_count) {
+    __builtin_prefetch(low + 8*k);
+    k = 2*k + (low[k] <= id);
+  }
+  k >>= __builtin_ffsl(k);
+  return (k != 0 && id <= this->high_table[k]);
+}
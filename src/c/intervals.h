@@ -38,11 +38,44 @@
 #include "macros.h"
 #include "util.h"
 
+/* The size of the mapped segments of the interval log file */
+#define INTERVALS_LOG_SEGMENT_SIZE (1L << 30)
+
+/* The sizes of the chunks of an interval store in intervals */
+#define INTERVALS_CHUNK_MIN_SIZE 1024
+#define INTERVALS_CHUNK_MAX_SIZE (1L << 22)
+
+/* The initial size of the hash table of the completed sets of a closure */
+#define INTERVALS_SHARED_INITIAL_SIZE 1024
+
+/* The sharing is stopped if less than 1/INTERVALS_SHARED_MIN_RATIO of the
+   first INTERVALS_SHARED_TRIAL_COUNT or more completed sets were shared */
+#define INTERVALS_SHARED_TRIAL_COUNT 65536
+#define INTERVALS_SHARED_MIN_RATIO 16
+
+/* Only the sets of at least this many intervals get a lookup layout; the
+   smaller ones fit in a few cache lines anyway */
+#define INTERVALS_SEARCH_MIN_COUNT 64
+
+void Intervals_reserve(vint max_ids);
 void Intervals_initialize_tc(vint max_ids);
+int Intervals_spill_to(char *directory, size_t memory_budget);
+void Intervals_close_spill();
+void Intervals_finalize_tc();
 Intervals *Intervals_new();
-void Intervals_completed(Intervals *this);
+void Intervals_delete(Intervals *this);
+IntervalStore *IntervalStore_new();
+void IntervalStore_delete(IntervalStore *this);
+Interval *Intervals_completed(Intervals *this, IntervalStore *store);
 vint Intervals_insert(Intervals *this, vint id);
 void Intervals_union(Intervals *this, Intervals *other);
+Intervals *Intervals_from_sorted(vint *ids, vint count);
+void Intervals_union_all(Intervals *this, Intervals *others, vint other_count);
+void Intervals_intersection(Intervals *this, Intervals *other);
+void Intervals_difference(Intervals *this, Intervals *other);
 vint Intervals_find(Intervals *this, vint id);
+void IntervalSearch_build(IntervalSearch *this, Interval *table, vint count);
+void IntervalSearch_free(IntervalSearch *this);
+vint IntervalSearch_find(IntervalSearch *this, vint id);
 
 #endif
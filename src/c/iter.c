@@ -0,0 +1,101 @@
+/*
+  =============================================================================
+  Author:  Esko Nuutila (enu@iki.fi)
+  Date:    2017-06-23
+  Date:    2022-07-12
+  Licence: MIT
+  =============================================================================
+  File: iter.c
+
+  Iterating over the successor components and successor vertices of a
+  component or a vertex in the transitive closure.
+  =============================================================================
+*/
+
+#include "iter.h"
+#include "tc.h"
+
+/* ==== Iterating over successor components ==== */
+
+void TCSCCIter_init(TCSCCIter *this, TC *tc, vint scc_id) {
+  this->reversep = tc->reversep;
+  this->tc = tc;
+  this->interval_table = tc->successor_table[scc_id];
+  this->current_interval_index = 0;
+  this->interval_limit = tc->successor_count_table[scc_id];
+  /* An empty range; the first call of next moves to the first interval */
+  this->to_scc_id = 0;
+  this->to_scc_limit = -1;
+}
+
+void TCSCCIter_init_vertex(TCSCCIter *this, TC *tc, vint vertex_id) {
+  TCSCCIter_init(this, tc, TC_vertex_id_to_scc_id(tc, vertex_id));
+}
+
+/* Fill the buffer with at most buffer_size next successor component ids.
+   Returns the number of ids put to the buffer; 0 when there are no more. */
+vint TCSCCIter_next(TCSCCIter *this, vint *buffer, vint buffer_size) {
+  vint n = 0;
+  while (n < buffer_size) {
+    if (this->to_scc_id > this->to_scc_limit) {
+      if (this->current_interval_index == this->interval_limit) {
+	break;
+      }
+      Interval *interval = &(this->interval_table[this->current_interval_index++]);
+      this->to_scc_id = interval->low;
+      this->to_scc_limit = interval->high;
+    }
+    vint to_scc_id = this->to_scc_id;
+    vint limit = this->to_scc_limit;
+    if (limit - to_scc_id >= buffer_size - n) {
+      limit = to_scc_id + buffer_size - n - 1;
+    }
+    while (to_scc_id <= limit) {
+      buffer[n++] = to_scc_id++;
+    }
+    this->to_scc_id = to_scc_id;
+  }
+  return n;
+}
+
+/* ==== Iterating over successor vertices ==== */
+
+void TCVertexIter_init(TCVertexIter *this, TC *tc, vint scc_id) {
+  TCSCCIter_init(&(this->scc_iter), tc, scc_id);
+  this->reversep = tc->reversep;
+  this->to_vertex_table = NULL;
+  this->to_vertex_count = this->to_vertex_index = 0;
+}
+
+void TCVertexIter_init_vertex(TCVertexIter *this, TC *tc, vint vertex_id) {
+  TCVertexIter_init(this, tc, TC_vertex_id_to_scc_id(tc, vertex_id));
+}
+
+/* Fill the buffer with at most buffer_size next successor vertex ids.
+   Returns the number of ids put to the buffer; 0 when there are no more. */
+vint TCVertexIter_next(TCVertexIter *this, vint *buffer, vint buffer_size) {
+  vint n = 0;
+  TC *tc = this->scc_iter.tc;
+  while (n < buffer_size) {
+    if (this->to_vertex_index == this->to_vertex_count) {
+      /* The vertices of the components of an interval are consecutive */
+      TCSCCIter *scc_iter = &(this->scc_iter);
+      if (scc_iter->current_interval_index == scc_iter->interval_limit) {
+	break;
+      }
+      Interval *interval = &(scc_iter->interval_table[scc_iter->current_interval_index++]);
+      vint offset = tc->vertex_offset_table[interval->low];
+      this->to_vertex_table = tc->vertex_table + offset;
+      this->to_vertex_count = tc->vertex_offset_table[interval->high + 1] - offset;
+      this->to_vertex_index = 0;
+    }
+    vint count = this->to_vertex_count - this->to_vertex_index;
+    if (count > buffer_size - n) {
+      count = buffer_size - n;
+    }
+    memcpy(buffer + n, this->to_vertex_table + this->to_vertex_index, count*sizeof(vint));
+    this->to_vertex_index += count;
+    n += count;
+  }
+  return n;
+}
@@ -0,0 +1,46 @@
+/*
+  =============================================================================
+  Author:  Esko Nuutila (enu@iki.fi)
+  Date:    2017-06-23
+  Date:    2022-07-12
+  Licence: MIT
+  =============================================================================
+  File: iter.h
+
+  Iterating over the successor components and successor vertices of a
+  component or a vertex in the transitive closure.
+
+  The iterators do not allocate any memory. The caller gives a buffer that
+  the iterator fills with the next batch of successors, for example:
+
+    TCVertexIter iter;
+    vint buffer[1024], n;
+    TCVertexIter_init_vertex(&iter, tc, vertex_id);
+    while ((n = TCVertexIter_next(&iter, buffer, 1024)) > 0) {
+      ... use buffer[0] ... buffer[n-1] ...
+    }
+
+  The successors are returned in the order of the successor sets, that is,
+  the components in increasing order of their ids and the vertices of each
+  component in the order of the component's vertex table. If the closure
+  was computed from a reversed digraph, reversep is set and the successors
+  are predecessors.
+  =============================================================================
+*/
+
+#ifndef _iter_h_
+#define _iter_h_
+
+#include "types.h"
+#include "macros.h"
+#include "util.h"
+
+void TCSCCIter_init(TCSCCIter *this, TC *tc, vint scc_id);
+void TCSCCIter_init_vertex(TCSCCIter *this, TC *tc, vint vertex_id);
+vint TCSCCIter_next(TCSCCIter *this, vint *buffer, vint buffer_size);
+
+void TCVertexIter_init(TCVertexIter *this, TC *tc, vint scc_id);
+void TCVertexIter_init_vertex(TCVertexIter *this, TC *tc, vint vertex_id);
+vint TCVertexIter_next(TCVertexIter *this, vint *buffer, vint buffer_size);
+
+#endif
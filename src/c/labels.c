@@ -0,0 +1,158 @@
+/*
+  =============================================================================
+  Author:  Esko Nuutila (enu@iki.fi)
+  Date:    2017-06-23
+  Date:    2022-07-12
+  Licence: MIT
+  =============================================================================
+  File: labels.c
+
+  Mapping textual vertex labels to vertex ids and back.
+  =============================================================================
+*/
+
+#include "labels.h"
+
+#define LABELS_ARENA_BLOCK_SIZE (1 << 20)
+#define LABELS_INITIAL_HASH_SIZE 1024
+
+/* FNV-1a */
+static unsigned long label_hash(const char *label, size_t length) {
+  unsigned long hash = 14695981039346656037UL;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (unsigned char)label[i];
+    hash *= 1099511628211UL;
+  }
+  return hash;
+}
+
+Labels *Labels_new() {
+  Labels *this = NEW(Labels);
+  this->arena_block = NULL;
+  this->arena_free = this->arena_limit = NULL;
+  this->hash_size = LABELS_INITIAL_HASH_SIZE;
+  this->hash_table = new_vint_table(this->hash_size, -1);
+  this->label_size = LABELS_INITIAL_HASH_SIZE/2;
+  this->label_table = NEWN(char*, this->label_size);
+  this->hash_values = NEWN(unsigned long, this->label_size);
+  this->label_count = 0;
+  return this;
+}
+
+void Labels_delete(Labels *this) {
+  char *block = this->arena_block;
+  while (block != NULL) {
+    char *next = *((char**)block);
+    DELETE(block);
+    block = next;
+  }
+  DELETE(this->hash_table);
+  DELETE(this->label_table);
+  DELETE(this->hash_values);
+  DELETE(this);
+}
+
+/* Copy the label to the arena. A label longer than the block size gets a block of its own. */
+static char *Labels_arena_copy(Labels *this, const char *label, size_t length) {
+  if (this->arena_free + length + 1 > this->arena_limit) {
+    size_t block_size = (length + 1 + sizeof(char*) > LABELS_ARENA_BLOCK_SIZE
+			 ? length + 1 + sizeof(char*) : LABELS_ARENA_BLOCK_SIZE);
+    char *block = NEWN(char, block_size);
+    /* The blocks are chained through their first word */
+    *((char**)block) = this->arena_block;
+    this->arena_block = block;
+    this->arena_free = block + sizeof(char*);
+    this->arena_limit = block + block_size;
+  }
+  char *result = this->arena_free;
+  memcpy(result, label, length);
+  result[length] = (char)0;
+  this->arena_free += length + 1;
+  return result;
+}
+
+static void Labels_grow_hash_table(Labels *this) {
+  vint hash_size = this->hash_size*2;
+  vint *hash_table = new_vint_table(hash_size, -1);
+  for (vint id = 0; id < this->label_count; id++) {
+    vint i = (vint)(this->hash_values[id] & (hash_size - 1));
+    while (hash_table[i] >= 0) {
+      i = (i + 1) & (hash_size - 1);
+    }
+    hash_table[i] = id;
+  }
+  DELETE(this->hash_table);
+  this->hash_table = hash_table;
+  this->hash_size = hash_size;
+}
+
+/* Return the position of the label in the hash table; either the slot
+   containing its id or the empty slot where it should be put. */
+static vint Labels_slot(Labels *this, const char *label, size_t length, unsigned long hash) {
+  vint mask = this->hash_size - 1;
+  vint i = (vint)(hash & mask);
+  vint id;
+  while ((id = this->hash_table[i]) >= 0) {
+    if (this->hash_values[id] == hash) {
+      char *other = this->label_table[id];
+      if (!strncmp(other, label, length) && other[length] == (char)0) {
+	break;
+      }
+    }
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+/* Return the vertex id of the label, assigning the next free id to a new label */
+vint Labels_intern(Labels *this, const char *label, size_t length) {
+  unsigned long hash = label_hash(label, length);
+  vint i = Labels_slot(this, label, length, hash);
+  if (this->hash_table[i] >= 0) {
+    return this->hash_table[i];
+  }
+  vint id = this->label_count++;
+  if (id == this->label_size) {
+    this->label_size *= 2;
+    this->label_table = (char**)realloc(this->label_table, sizeof(char*)*this->label_size);
+    this->hash_values = (unsigned long*)realloc(this->hash_values, sizeof(unsigned long)*this->label_size);
+  }
+  this->label_table[id] = Labels_arena_copy(this, label, length);
+  this->hash_values[id] = hash;
+  this->hash_table[i] = id;
+  /* Keep the load factor at most 1/2 */
+  if (2*this->label_count > this->hash_size) {
+    Labels_grow_hash_table(this);
+  }
+  return id;
+}
+
+/* Return the vertex id of the label or -1 if it has not been interned */
+vint Labels_find(Labels *this, const char *label, size_t length) {
+  vint i = Labels_slot(this, label, length, label_hash(label, length));
+  return this->hash_table[i];
+}
+
+char *Labels_label(Labels *this, vint vertex_id) {
+  return this->label_table[vertex_id];
+}
+
+/* Renumber the vertex ids: the id i becomes new_ids[i]. The new ids must be
+   a permutation of the old ones. The labels stay in the arena. */
+void Labels_relabel(Labels *this, vint *new_ids) {
+  char **label_table = NEWN(char*, this->label_size);
+  unsigned long *hash_values = NEWN(unsigned long, this->label_size);
+  for (vint id = 0; id < this->label_count; id++) {
+    label_table[new_ids[id]] = this->label_table[id];
+    hash_values[new_ids[id]] = this->hash_values[id];
+  }
+  for (vint i = 0; i < this->hash_size; i++) {
+    if (this->hash_table[i] >= 0) {
+      this->hash_table[i] = new_ids[this->hash_table[i]];
+    }
+  }
+  DELETE(this->label_table);
+  DELETE(this->hash_values);
+  this->label_table = label_table;
+  this->hash_values = hash_values;
+}
@@ -0,0 +1,32 @@
+/*
+  =============================================================================
+  Author:  Esko Nuutila (enu@iki.fi)
+  Date:    2017-06-23
+  Date:    2022-07-12
+  Licence: MIT
+  =============================================================================
+  File: labels.h
+
+  Mapping textual vertex labels to vertex ids and back.
+
+  The labels are interned: each distinct label is copied once to an arena of
+  large character blocks and gets the next free vertex id. The ids are found
+  using an open addressing hash table with linear probing.
+  =============================================================================
+*/
+
+#ifndef _labels_h_
+#define _labels_h_
+
+#include "types.h"
+#include "macros.h"
+#include "util.h"
+
+Labels *Labels_new();
+void Labels_delete(Labels *this);
+vint Labels_intern(Labels *this, const char *label, size_t length);
+vint Labels_find(Labels *this, const char *label, size_t length);
+char *Labels_label(Labels *this, vint vertex_id);
+void Labels_relabel(Labels *this, vint *new_ids);
+
+#endif
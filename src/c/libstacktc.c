@@ -0,0 +1,201 @@
+/*
+  =============================================================================
+  Author:  Esko Nuutila (enu@iki.fi)
+  Date:    2017-06-23
+  Date:    2022-07-12
+  Licence: MIT
+  =============================================================================
+  File: libstacktc.c
+
+  The public interface of the library libstacktc, see stacktc.h.
+  =============================================================================
+*/
+
+#include "stacktc.h"
+#include "algorithm.h"
+#include "digraph.h"
+#include "iter.h"
+
+/* The interval tables are returned as such */
+_Static_assert(sizeof(stacktc_id) == sizeof(vint), "stacktc_id must be vint");
+_Static_assert(sizeof(stacktc_interval) == sizeof(Interval), "stacktc_interval must be Interval");
+
+/* ==== Digraphs ==== */
+
+stacktc_graph *stacktc_graph_new(const stacktc_id *from, const stacktc_id *to, stacktc_id edge_count, stacktc_id vertex_count) {
+  vint max_vertex = -1;
+  for (vint i = 0; i < edge_count; i++) {
+    if (from[i] < 0 || to[i] < 0) {
+      return NULL;
+    }
+    max_vertex = (from[i] > max_vertex ? from[i] : max_vertex);
+    max_vertex = (to[i] > max_vertex ? to[i] : max_vertex);
+  }
+  if (vertex_count < 0) {
+    vertex_count = max_vertex + 1;
+  } else if (max_vertex >= vertex_count) {
+    return NULL;
+  }
+  EDGE *edges = NEWN(EDGE, edge_count);
+  for (vint i = 0; i < edge_count; i++) {
+    edges[i].from = from[i];
+    edges[i].to = to[i];
+  }
+  Digraph *result = digraph_from_edges(edges, edge_count, vertex_count);
+  DELETE(edges);
+  return result;
+}
+
+void stacktc_graph_free(stacktc_graph *graph) {
+  if (graph != NULL) {
+    digraph_delete(graph);
+  }
+}
+
+stacktc_id stacktc_graph_vertex_count(const stacktc_graph *graph) {
+  return graph->vertex_count;
+}
+
+stacktc_id stacktc_graph_edge_count(const stacktc_graph *graph) {
+  return graph->edge_count;
+}
+
+/* ==== Closures ==== */
+
+stacktc_closure *stacktc_closure_new(const stacktc_graph *graph) {
+  return stacktc((Digraph*)graph);
+}
+
+void stacktc_closure_free(stacktc_closure *closure) {
+  if (closure != NULL) {
+    TC_delete(closure);
+  }
+}
+
+void stacktc_closure_free_workspace(void) {
+  stacktc_free_workspace();
+}
+
+stacktc_id stacktc_closure_vertex_count(const stacktc_closure *closure) {
+  return closure->vertex_id_count;
+}
+
+stacktc_id stacktc_closure_component_count(const stacktc_closure *closure) {
+  return closure->scc_count;
+}
+
+stacktc_id stacktc_closure_component(const stacktc_closure *closure, stacktc_id vertex) {
+  if (vertex < 0 || vertex >= closure->vertex_id_count) {
+    return -1;
+  }
+  return closure->vertex_id_to_scc_id_table[vertex];
+}
+
+int stacktc_closure_components_reachable(const stacktc_closure *closure, stacktc_id from_component, stacktc_id to_component) {
+  if (from_component < 0 || from_component >= closure->scc_count
+      || to_component < 0 || to_component >= closure->scc_count) {
+    return 0;
+  }
+  return (int)TC_sccs_edge_exists((TC*)closure, from_component, to_component);
+}
+
+int stacktc_closure_reachable(const stacktc_closure *closure, stacktc_id from, stacktc_id to) {
+  return stacktc_closure_components_reachable(closure,
+					      stacktc_closure_component(closure, from),
+					      stacktc_closure_component(closure, to));
+}
+
+void stacktc_closure_build_index(stacktc_closure *closure) {
+  TC_build_search(closure);
+}
+
+static int valid_vertices(const stacktc_closure *closure, const stacktc_id *vertices, stacktc_id count) {
+  for (stacktc_id i = 0; i < count; i++) {
+    if (vertices[i] < 0 || vertices[i] >= closure->vertex_id_count) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+int stacktc_closure_reachable_pairs(const stacktc_closure *closure, const stacktc_id *from, const stacktc_id *to,
+				    stacktc_id count, unsigned char *result) {
+  if (!valid_vertices(closure, from, count) || !valid_vertices(closure, to, count)) {
+    return 0;
+  }
+  for (stacktc_id i = 0; i < count; i++) {
+    result[i] = (unsigned char)stacktc_closure_reachable(closure, from[i], to[i]);
+  }
+  return 1;
+}
+
+stacktc_id stacktc_closure_reachable_targets(const stacktc_closure *closure,
+					     const stacktc_id *sources, stacktc_id source_count,
+					     const stacktc_id *targets, stacktc_id target_count,
+					     stacktc_id *result) {
+  if (!valid_vertices(closure, sources, source_count)
+      || !valid_vertices(closure, targets, target_count)) {
+    return -1;
+  }
+  return TC_reachable_targets((TC*)closure, (vint*)sources, source_count,
+			      (vint*)targets, target_count, 0, result);
+}
+
+stacktc_id stacktc_closure_component_vertices(const stacktc_closure *closure, stacktc_id component, const stacktc_id **vertices) {
+  if (component < 0 || component >= closure->scc_count) {
+    return -1;
+  }
+  *vertices = TC_scc_vertices((TC*)closure, component);
+  return TC_scc_vertex_count((TC*)closure, component);
+}
+
+stacktc_id stacktc_closure_component_intervals(const stacktc_closure *closure, stacktc_id component, const stacktc_interval **intervals) {
+  if (component < 0 || component >= closure->scc_count) {
+    return -1;
+  }
+  *intervals = (const stacktc_interval*)closure->successor_table[component];
+  return closure->successor_count_table[component];
+}
+
+const stacktc_id *stacktc_closure_component_table(const stacktc_closure *closure) {
+  return closure->vertex_id_to_scc_id_table;
+}
+
+const stacktc_id *stacktc_closure_vertex_table(const stacktc_closure *closure, const stacktc_id **offsets) {
+  *offsets = closure->vertex_offset_table;
+  return closure->vertex_table;
+}
+
+/* ==== Iterators ==== */
+
+stacktc_iterator *stacktc_iterator_vertex_successors(const stacktc_closure *closure, stacktc_id vertex) {
+  if (stacktc_closure_component(closure, vertex) < 0) {
+    return NULL;
+  }
+  TCIter *this = NEW(TCIter);
+  this->vertexp = 1;
+  TCVertexIter_init_vertex(&this->vertex_iter, (TC*)closure, vertex);
+  return this;
+}
+
+stacktc_iterator *stacktc_iterator_component_successors(const stacktc_closure *closure, stacktc_id component) {
+  if (component < 0 || component >= closure->scc_count) {
+    return NULL;
+  }
+  TCIter *this = NEW(TCIter);
+  this->vertexp = 0;
+  TCSCCIter_init(&this->scc_iter, (TC*)closure, component);
+  return this;
+}
+
+stacktc_id stacktc_iterator_next(stacktc_iterator *iterator, stacktc_id *buffer, stacktc_id buffer_size) {
+  if (iterator->vertexp) {
+    return TCVertexIter_next(&iterator->vertex_iter, buffer, buffer_size);
+  } else {
+    return TCSCCIter_next(&iterator->scc_iter, buffer, buffer_size);
+  }
+}
+
+void stacktc_iterator_free(stacktc_iterator *iterator) {
+  DELETE(iterator);
+}
@@ -12,7 +12,11 @@
 #include "algorithm.h"
 #include "warshall.h"
 #include "digraph.h"
+#include "reader.h"
 #include "output.h"
+#include "engines.h"
+#include "batch.h"
+#include <unistd.h>
 
 void usage(char* pgm) {
   fprintf(stderr, "usage: %s options [input [output]]\n", pgm);
@@ -24,8 +28,10 @@ void usage(char* pgm) {
   fprintf(stderr, "\n");
   fprintf(stderr, "The input is csv file of two columns. The lines are pairs of integers each representing\n");
   fprintf(stderr, "an edge FROM,TO, where FROM and TO are integers representing the vertices of the graph.\n");
+  fprintf(stderr, "With the option '--labels' the vertices can be arbitrary strings without commas.\n");
   fprintf(stderr, "If the input file (as well as the output file) is omitted or is '-', the input is read\n");
   fprintf(stderr, "from the standard input.\n");
+  fprintf(stderr, "The input may be gzip or zstd compressed; it is decompressed while reading.\n");
   fprintf(stderr, "\n");
   fprintf(stderr, "Several output formats are available using the options; the default is '--intervals'.\n");
   fprintf(stderr, "If the output file is omitted or is '-', the output is written to the standard output.\n");
@@ -39,7 +45,59 @@ void usage(char* pgm) {
   fprintf(stderr, "                           The result is in JSON format.\n");
   fprintf(stderr, "    -E | --component-edges Output as lines of edges FROM_COMPONENT, TO_COMPONENT. The result is in CSV format.\n");
   fprintf(stderr, "    -e | --edges           Output as lines of edges FROM_VERTEX, TO_VERTEX. The result is in CSV format.\n");
+  fprintf(stderr, "    -R | --reduction       Output the transitive reduction: for each strong component its vertices\n");
+  fprintf(stderr, "                           as a synthetic cycle of new edges from each vertex to the next and\n");
+  fprintf(stderr, "                           from the last to the first, replacing the edges inside the component,\n");
+  fprintf(stderr, "                           and its adjacent components in the reduction of the condensation\n");
+  fprintf(stderr, "                           graph. The result is in JSON format.\n");
+  fprintf(stderr, "    -C | --condensation    Output only the strong component of each vertex and the edges between\n");
+  fprintf(stderr, "                           the components. The closure is not computed, so this is fast even when\n");
+  fprintf(stderr, "                           the closure is huge. The result is in JSON format.\n");
+  fprintf(stderr, "    -S | --estimate        Output estimates of the sizes of the successor sets of the components,\n");
+  fprintf(stderr, "                           of the outputs of '--edges' and '--vertices' and of the memory needed,\n");
+  fprintf(stderr, "                           with the relative error of the inexact ones. As with '--condensation',\n");
+  fprintf(stderr, "                           the closure is not computed. The result is in JSON format.\n");
   fprintf(stderr, "    -n | --nothing         Don't output the result.\n");
+  fprintf(stderr, "    -k | --compact         The vertex numbers in the input are sparse, for example hash values.\n");
+  fprintf(stderr, "                           They are mapped to a dense range while reading, so that the memory needed\n");
+  fprintf(stderr, "                           depends on the number of vertices and not on the largest number. The\n");
+  fprintf(stderr, "                           output uses the numbers of the input.\n");
+  fprintf(stderr, "    -l | --labels          The vertices in the input are labels instead of numbers. The vertices\n");
+  fprintf(stderr, "                           in the output (and in the sources file) are the same labels.\n");
+  fprintf(stderr, "    -a | --algorithm NAME  The algorithm used for computing the closure. The default is stacktc.\n");
+  fprintf(stderr, "                           The others find the strong components first and then compute the\n");
+  fprintf(stderr, "                           successor sets by a breadth-first search from each component (bfs),\n");
+  fprintf(stderr, "                           in reverse topological order (topological), or by a bit-parallel\n");
+  fprintf(stderr, "                           Warshall's algorithm on the components (warshall). The result is the same.\n");
+  fprintf(stderr, "    -b | --batch MANIFEST  Compute the closures of many digraphs. MANIFEST is a csv file with a\n");
+  fprintf(stderr, "                           header line, each line naming an INPUT,OUTPUT pair of files. The other\n");
+  fprintf(stderr, "                           options apply to each digraph. The digraphs are divided between the\n");
+  fprintf(stderr, "                           threads of '--threads', and the number of graphs per second is reported.\n");
+  fprintf(stderr, "    -m | --memory SIZE     Keep at most SIZE bytes of successor sets in memory, for example 64G.\n");
+  fprintf(stderr, "                           The rest are written to a temporary file that is mapped to memory, so\n");
+  fprintf(stderr, "                           that closures larger than the memory can be computed.\n");
+  fprintf(stderr, "    -M | --edge-memory SIZE Keep at most SIZE bytes of input edges in memory while reading. The rest\n");
+  fprintf(stderr, "                           are sorted in runs written to temporary files and merged into the digraph,\n");
+  fprintf(stderr, "                           so that inputs whose edges do not fit in memory can be read.\n");
+  fprintf(stderr, "    -d | --spill-dir DIR   The directory of the temporary files of '--memory' and '--edge-memory'.\n");
+  fprintf(stderr, "                           The default is $TMPDIR or /tmp. Use a fast local disk.\n");
+  fprintf(stderr, "    -r | --reverse         Compute the predecessor sets (ancestors) instead of the successor sets.\n");
+  fprintf(stderr, "                           The output formats are the same, but the JSON successor lists are tagged\n");
+  fprintf(stderr, "                           \"predecessors\" and the CSV header is TO,FROM.\n");
+  fprintf(stderr, "    -L | --relabel ORDER   Renumber the vertices in depth-first preorder (dfs) or in breadth-first\n");
+  fprintf(stderr, "                           order (bfs) before computing the closure, so that the vertices visited\n");
+  fprintf(stderr, "                           one after another are near each other in memory. The output uses the\n");
+  fprintf(stderr, "                           vertices of the input, but lists them in the new order. The closure is\n");
+  fprintf(stderr, "                           computed faster, but the renumbering takes about as long as one search\n");
+  fprintf(stderr, "                           of the digraph, so it pays off when the closure dominates the run.\n");
+  fprintf(stderr, "    -s | --sources FILE    Compute the closure only for the vertices reachable from the vertices\n");
+  fprintf(stderr, "                           listed in FILE, one per line after a header line. Only these vertices\n");
+  fprintf(stderr, "                           and their components are output.\n");
+  fprintf(stderr, "    -q | --query FILE      Output only the vertices listed in FILE, one per line after a header line,\n");
+  fprintf(stderr, "                           that are reachable from any of the vertices of '--sources'. The result is\n");
+  fprintf(stderr, "                           in CSV format.\n");
+  fprintf(stderr, "    -t | --threads N       Use N threads for parsing the input, or for the digraphs of '--batch'.\n");
+  fprintf(stderr, "                           The default is the number of processors.\n");
   fprintf(stderr, "    -w | --warshall        Check the result against the matrix based Warshall's algorithm.\n");
   fprintf(stderr, "    -h | --help            Print help text\n");
   exit(1);
@@ -53,6 +111,17 @@ int main(int argc, char** argv) {
   enum output_format output_tc_as = output_intervals;
   int i = 1;
   int compare_with_warshall = 0;
+  int reverse = 0;
+  enum relabel_order relabel = 0;
+  enum input_format input_as = input_numbers;
+  char* sources_file = NULL;
+  char* query_file = NULL;
+  int thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  vint memory_budget = -1;
+  vint edge_memory_budget = -1;
+  enum tc_algorithm algorithm = algorithm_stacktc;
+  char* manifest_file = NULL;
+  char* spill_directory = (getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp");
   for (; i < argc; i++) {
     char *arg = argv[i];
     if (!strcmp(arg, "-h") || !strcmp(arg, "--help")) {
@@ -67,27 +136,126 @@ int main(int argc, char** argv) {
       output_tc_as = output_component_edges;
     } else if (!strcmp(arg, "-i") || !strcmp(arg, "--intervals")) {
       output_tc_as = output_intervals;
+    } else if (!strcmp(arg, "-R") || !strcmp(arg, "--reduction")) {
+      output_tc_as = output_reduction;
+    } else if (!strcmp(arg, "-C") || !strcmp(arg, "--condensation")) {
+      output_tc_as = output_condensation;
+    } else if (!strcmp(arg, "-S") || !strcmp(arg, "--estimate")) {
+      output_tc_as = output_estimate;
     } else if (!strcmp(arg, "-n") || !strcmp(arg, "--nothing")) {
       output_tc_as = output_nothing;
+    } else if (!strcmp(arg, "-k") || !strcmp(arg, "--compact")) {
+      input_as = input_sparse_numbers;
+    } else if (!strcmp(arg, "-l") || !strcmp(arg, "--labels")) {
+      input_as = input_labels;
+    } else if (!strcmp(arg, "-a") || !strcmp(arg, "--algorithm")) {
+      if (++i == argc || !(algorithm = algorithm_from_name(argv[i]))) {
+	usage(pgm);
+      }
+    } else if (!strcmp(arg, "-b") || !strcmp(arg, "--batch")) {
+      if (++i == argc) {
+	usage(pgm);
+      }
+      manifest_file = argv[i];
+    } else if (!strcmp(arg, "-m") || !strcmp(arg, "--memory")) {
+      if (++i == argc || (memory_budget = parse_size(argv[i])) < 0) {
+	usage(pgm);
+      }
+    } else if (!strcmp(arg, "-M") || !strcmp(arg, "--edge-memory")) {
+      if (++i == argc || (edge_memory_budget = parse_size(argv[i])) < 0) {
+	usage(pgm);
+      }
+    } else if (!strcmp(arg, "-d") || !strcmp(arg, "--spill-dir")) {
+      if (++i == argc) {
+	usage(pgm);
+      }
+      spill_directory = argv[i];
+    } else if (!strcmp(arg, "-r") || !strcmp(arg, "--reverse")) {
+      reverse = 1;
+    } else if (!strcmp(arg, "-L") || !strcmp(arg, "--relabel")) {
+      if (++i == argc || !(relabel = relabel_order_from_name(argv[i]))) {
+	usage(pgm);
+      }
+    } else if (!strcmp(arg, "-s") || !strcmp(arg, "--sources")) {
+      if (++i == argc) {
+	usage(pgm);
+      }
+      sources_file = argv[i];
+    } else if (!strcmp(arg, "-q") || !strcmp(arg, "--query")) {
+      if (++i == argc) {
+	usage(pgm);
+      }
+      query_file = argv[i];
+    } else if (!strcmp(arg, "-t") || !strcmp(arg, "--threads")) {
+      if (++i == argc || (thread_count = atoi(argv[i])) < 1) {
+	usage(pgm);
+      }
     } else if (!strcmp(arg, "-w") || !strcmp(arg, "--warshall")) {
       compare_with_warshall = 1;
-    } else if (strlen(arg) > 0 && arg[0] == '-') {
+    } else if (strlen(arg) > 1 && arg[0] == '-') {
       fprintf(stderr, "%s: Unknown option %s\n", pgm, arg);
       exit(1);
     } else {
       break;
     }
   }
-  if (argc - i < 1 || argc - i > 2) {
+  if (argc - i > 2) {
     usage(pgm);
   }
-  char* input_file = argv[i];
-  input_graph = digraph_read(input_file);
+  enum tc_mode mode = (output_tc_as == output_reduction ? tc_reduction :
+		       output_tc_as == output_condensation || output_tc_as == output_estimate ? tc_condensation : tc_closure);
+  if (mode == tc_reduction && algorithm != algorithm_stacktc) {
+    fprintf(stderr, "%s: The option --reduction works only with the algorithm stacktc\n", pgm);
+    exit(1);
+  }
+  if (query_file != NULL && (sources_file == NULL || mode == tc_condensation)) {
+    fprintf(stderr, "%s: The option --query needs --sources and cannot be used with --condensation\n", pgm);
+    exit(1);
+  }
+  if (manifest_file != NULL) {
+    if (argc - i > 0 || sources_file != NULL || compare_with_warshall || memory_budget >= 0
+	|| edge_memory_budget >= 0 || relabel) {
+      fprintf(stderr, "%s: The option --batch cannot be used with input files, --sources, --query, --warshall, --memory,\n"
+	      "--edge-memory or --relabel\n", pgm);
+      exit(1);
+    }
+    exit(batch_run(manifest_file, thread_count, input_as, reverse, algorithm, mode, output_tc_as) ? 0 : 1);
+  }
+  char* input_file = (argc - i >= 1 ? argv[i] : NULL);
+  if (edge_memory_budget >= 0 && !EdgeBuffer_spill_to(spill_directory, edge_memory_budget)) {
+    fprintf(stderr, "%s: Cannot create a file in %s\n", pgm, spill_directory);
+    exit(1);
+  }
+  if (!(input_graph = digraph_read(input_file, input_as, thread_count))) {
+    exit(1);
+  }
+  if (reverse) {
+    input_graph = digraph_reverse(input_graph);
+  }
+  if (relabel) {
+    Digraph *relabeled_graph = digraph_relabel(input_graph, relabel);
+    digraph_delete(input_graph);
+    input_graph = relabeled_graph;
+  }
+
+  if (memory_budget >= 0 && !Intervals_spill_to(spill_directory, memory_budget)) {
+    fprintf(stderr, "%s: Cannot create a file in %s\n", pgm, spill_directory);
+    exit(1);
+  }
 
   DBG("Stacktc\n");
-  stack_tc_result = stacktc(input_graph);
+  vint source_count = 0;
+  vint *sources = NULL;
+  if (sources_file != NULL) {
+    sources = digraph_read_vertices(input_graph, sources_file, &source_count);
+    stack_tc_result = tc_compute(input_graph, sources, source_count, mode, algorithm);
+  } else {
+    stack_tc_result = tc_compute(input_graph, NULL, 0, mode, algorithm);
+  }
 
-  if (compare_with_warshall) {
+  if (compare_with_warshall && mode == tc_condensation) {
+    fprintf(stderr, "The closure is not computed with --condensation, not comparing with Warshall.\n");
+  } else if (compare_with_warshall) {
     Matrix *input_matrix = digraph_to_matrix(input_graph);
     DBG("Input graph as matrix\n");
     DBGCALL(output_matrix(m, stderr));
@@ -104,6 +272,10 @@ int main(int argc, char** argv) {
     vint *stack_tc_elements = stack_tc_matrix->elements;
     int same = 1;
     for (int i = 0; i < n; i++) {
+      if (TC_vertex_id_to_scc_id(stack_tc_result, i) < 0) {
+	/* Not reachable from the sources */
+	continue;
+      }
       for (int j = 0; j < n; j++) {
 	if (stack_tc_elements[i*n + j] != warshall_elements[i*n + j]) {
 	  fprintf(stderr, "difference at (%d,%d)\n", i, j);
@@ -117,5 +289,21 @@ int main(int argc, char** argv) {
       fprintf(stderr, "Stacktc and Warshall results are not equal!\n");
     }
   }
-  output_result(stack_tc_result, (argc - i == 2 ? argv[i + 1] : NULL), output_tc_as);
+  if (query_file != NULL) {
+    vint target_count;
+    vint *targets = digraph_read_vertices(input_graph, query_file, &target_count);
+    if (!output_reachable_targets(stack_tc_result, (argc - i == 2 ? argv[i + 1] : NULL),
+				  sources, source_count, targets, target_count)) {
+      exit(1);
+    }
+    DELETE(targets);
+  } else if (!output_result(stack_tc_result, input_graph, (argc - i == 2 ? argv[i + 1] : NULL), output_tc_as)) {
+    exit(1);
+  }
+  if (memory_budget >= 0) {
+    /* Unmap the spilled successor sets and remove the log file */
+    TC_delete(stack_tc_result);
+    Intervals_close_spill();
+  }
+  DELETE(sources);
 }
@@ -13,79 +13,228 @@
 
 
 #include "output.h"
+#include "tc.h"
+#include "iter.h"
+#include "labels.h"
+#include "idmap.h"
+#include "estimate.h"
+
+/* The number of successors fetched from an iterator at a time */
+#define OUTPUT_BUFFER_SIZE 1024
+
+/* The maximum bytes of successor lists kept for later uses of shared sets */
+#define OUTPUT_SHARED_MEMORY (256L << 20)
+
+/* A successor list used several times, by the vertices of a component or
+   by the components sharing a successor set (see Intervals_completed). The
+   list is written to text when it is used for the first time, and the text
+   is freed after the last use. */
+typedef struct shared_list_struct {
+  Interval *set; /* The table of the successor set */
+  char *text;
+  size_t length;
+  vint uses; /* The uses left */
+} SharedList;
+
+typedef struct shared_lists_struct {
+  SharedList *table;
+  vint size; /* Always a power of two */
+  size_t memory_used;
+  int vertexp; /* Lists of vertices instead of components */
+} SharedLists;
+
+/* The JSON tag and the CSV header depend on whether the closure contains the
+   successor or the predecessor sets of the original digraph. */
+static char *successors_tag(TC* tc) {
+  return (tc->reversep ? "predecessors" : "successors");
+}
+
+static char *edges_header(TC* tc) {
+  return (tc->reversep ? "to,from" : "from,to");
+}
+
+/* Output a string as a JSON string literal */
+static void output_json_string(FILE* output, char* string) {
+  putc('"', output);
+  for (char* c = string; *c; c++) {
+    if (*c == '"' || *c == '\\') {
+      fprintf(output, "\\%c", *c);
+    } else if ((unsigned char)*c < 0x20) {
+      fprintf(output, "\\u%04x", (unsigned char)*c);
+    } else {
+      putc(*c, output);
+    }
+  }
+  putc('"', output);
+}
+
+/* Output a vertex either as its number in the input or as its label. In JSON, the labels are strings. */
+static void output_vertex(TC* tc, FILE* output, vint vertex_id, int jsonp) {
+  if (tc->id_map != NULL) {
+    fprintf(output, VFMT, IdMap_original_id(tc->id_map, vertex_id));
+  } else if (tc->labels == NULL) {
+    fprintf(output, VFMT, vertex_id);
+  } else if (jsonp) {
+    output_json_string(output, Labels_label(tc->labels, vertex_id));
+  } else {
+    fputs(Labels_label(tc->labels, vertex_id), output);
+  }
+}
+
+static SharedList *SharedLists_find(SharedLists *this, Interval *set) {
+  vint mask = this->size - 1;
+  vint slot = (vint)((((unsigned long)set) >> 4)*11400714819323198485UL >> 20) & mask;
+  while (this->table[slot].set != NULL && this->table[slot].set != set) {
+    slot = (slot + 1) & mask;
+  }
+  return &(this->table[slot]);
+}
+
+/* Count the uses of each successor set, one for each vertex or component */
+static SharedLists *SharedLists_new(TC* tc, int vertexp) {
+  SharedLists *this = NEW(SharedLists);
+  this->size = 1;
+  while (this->size < 2*tc->scc_count) {
+    this->size *= 2;
+  }
+  this->table = NEWN(SharedList, this->size);
+  memset(this->table, 0, sizeof(SharedList)*this->size);
+  this->memory_used = 0;
+  this->vertexp = vertexp;
+  for (vint i = 0; i < tc->scc_count; i++) {
+    Interval *set = tc->successor_table[i];
+    if (set != NULL) {
+      SharedList *list = SharedLists_find(this, set);
+      list->set = set;
+      list->uses += (vertexp ? TC_scc_vertex_count(tc, i) : 1);
+    }
+  }
+  return this;
+}
+
+static void SharedLists_delete(SharedLists *this) {
+  for (vint i = 0; i < this->size; i++) {
+    DELETE(this->table[i].text);
+  }
+  DELETE(this->table);
+  DELETE(this);
+}
+
+/* Output the successors of the component, separated by commas */
+static void output_successor_list(TC* tc, FILE* output, vint scc_id, int vertexp) {
+  vint buffer[OUTPUT_BUFFER_SIZE];
+  char* sep = "";
+  vint count;
+  if (vertexp) {
+    TCVertexIter iter;
+    TCVertexIter_init(&iter, tc, scc_id);
+    while ((count = TCVertexIter_next(&iter, buffer, OUTPUT_BUFFER_SIZE)) > 0) {
+      for (vint w = 0; w < count; w++) {
+	fputs(sep, output);
+	output_vertex(tc, output, buffer[w], 1);
+	sep = ", ";
+      }
+    }
+  } else {
+    TCSCCIter iter;
+    TCSCCIter_init(&iter, tc, scc_id);
+    while ((count = TCSCCIter_next(&iter, buffer, OUTPUT_BUFFER_SIZE)) > 0) {
+      for (vint c = 0; c < count; c++) {
+	fprintf(output, "%s" VFMT, sep, buffer[c]);
+	sep = ", ";
+      }
+    }
+  }
+}
+
+/* Output the successor list of the component, using the text of an earlier
+   use of the same set if it has been kept */
+static void output_shared_successor_list(SharedLists *this, TC* tc, FILE* output, vint scc_id) {
+  Interval *set = tc->successor_table[scc_id];
+  SharedList *list = (set != NULL ? SharedLists_find(this, set) : NULL);
+  if (list == NULL || (list->text == NULL && list->uses == 1)) {
+    output_successor_list(tc, output, scc_id, this->vertexp);
+  } else if (list->text != NULL) {
+    fwrite(list->text, 1, list->length, output);
+  } else {
+    FILE *text_output = open_memstream(&(list->text), &(list->length));
+    output_successor_list(tc, text_output, scc_id, this->vertexp);
+    fclose(text_output);
+    fwrite(list->text, 1, list->length, output);
+    if (this->memory_used + list->length > OUTPUT_SHARED_MEMORY) {
+      /* Written again for the other uses */
+      DELETE(list->text);
+      list->text = NULL;
+    } else {
+      this->memory_used += list->length;
+    }
+  }
+  if (list != NULL && --list->uses == 0 && list->text != NULL) {
+    this->memory_used -= list->length;
+    DELETE(list->text);
+    list->text = NULL;
+  }
+}
 
 /* Output a the transitive closure vertices and their successors as JSON */
 void output_tc_vertices(TC* tc, FILE* output, enum output_format output_as) {
-  vint* vertices = tc->vertex_table;
-  vint n = tc->vertex_count;
-  vint* vertex_to_scc = tc->vertex_id_to_scc_id_table;
-  SCC** scc_table = tc->scc_table;
-  fprintf(output, "[\n");
+  vint n = tc->vertex_id_count;
+  SharedLists *lists = SharedLists_new(tc, 1);
+  char* row_sep = "";
+  fprintf(output, "[");
   for (vint v = 0; v < n; v++) {
-    fprintf(output, "    {\n");
-    fprintf(output, "        \"id\": " VFMT ",\n", v);
-    fprintf(output, "        \"successors\": [");
-    SCC* from_scc = scc_table[vertex_to_scc[v]];
-    Intervals* intervals = from_scc->successors;
-    if (intervals != NULL) {
-      char* sep = "";
-      for (vint i = 0; i < intervals->interval_count; i++) {
-	Interval *interval = &(intervals->interval_table[i]);
-	for (vint t = interval->low; t <= interval->high; t++) {
-	  SCC* to_scc = tc->scc_table[t];
-	  for (vint w = 0; w < to_scc->vertex_count; w++) {
-	    fprintf(output, "%s" VFMT, sep, to_scc->vertex_table[w]);
-	    sep = ", ";
-	  }
-	}
-      }
+    if (TC_vertex_id_to_scc_id(tc, v) < 0) {
+      /* Not reachable from the sources */
+      continue;
     }
+    fprintf(output, "%s\n    {\n", row_sep);
+    row_sep = ",";
+    fprintf(output, "        \"id\": ");
+    output_vertex(tc, output, v, 1);
+    fprintf(output, ",\n");
+    fprintf(output, "        \"%s\": [", successors_tag(tc));
+    output_shared_successor_list(lists, tc, output, TC_vertex_id_to_scc_id(tc, v));
     fprintf(output, "]\n");
-    if (v < n - 1) {
-      fprintf(output, "    },\n");
-    } else {
-      fprintf(output, "    }\n");
-    }
+    fprintf(output, "    }");
   }
-  fprintf(output, "]\n");
+  fprintf(output, "\n]\n");
+  SharedLists_delete(lists);
 }
 
 /* Output a the transitive closure strong components and their successors as JSON.
    Based on the parameter output_as, output the successors either as intervals or
    as lists. */
 void output_tc_components(TC* tc, FILE* output, enum output_format output_as) {
-  SCC** components = tc->scc_table;
   vint scc_count = tc->scc_count;
+  SharedLists *lists = (output_as == output_intervals ? NULL : SharedLists_new(tc, 0));
   fprintf(output, "[\n");
   for (vint i = 0; i < scc_count; i++) {
-    SCC *scc = components[i];
+    SCC scc = TC_scc_id_to_scc(tc, i);
     fprintf(output, "    {\n");
     fprintf(output, "        \"scc\": " VFMT ",\n", i);
-    fprintf(output, "        \"root\": " VFMT ",\n", scc->root_vertex_id);
+    fprintf(output, "        \"root\": ");
+    output_vertex(tc, output, scc.root_vertex_id, 1);
+    fprintf(output, ",\n");
     fprintf(output, "        \"vertices\": [");
     char* sep = "";
-    for (vint j = 0; j < scc->vertex_count; j++) {
-      fprintf(output, "%s" VFMT, sep, scc->vertex_table[j]);
+    for (vint j = 0; j < scc.vertex_count; j++) {
+      fputs(sep, output);
+      output_vertex(tc, output, scc.vertex_table[j], 1);
       sep = ", ";
     }
     fprintf(output, "],\n");
-    char* succ_tag = (output_as == output_intervals ? "intervals" : "successors");
+    char* succ_tag = (output_as == output_intervals ? "intervals" : successors_tag(tc));
     fprintf(output, "        \"%s\": [", succ_tag);
-    Intervals* intervals = scc->successors;
-    if (intervals != NULL) {
-      char* sep = "";
+    sep = "";
+    if (output_as == output_intervals) {
+      Intervals *intervals = &(scc.successors);
       for (vint j = 0; j < intervals->interval_count; j++) {
 	Interval *interval = &(intervals->interval_table[j]);
-	if (output_as == output_intervals) {
-	  fprintf(output, "%s{\"low\": " VFMT ", \"high\": " VFMT "}", sep, interval->low, interval->high);
-	  sep = ", ";
-	} else {
-	  for (vint c = interval->low; c <= interval->high; c++) {
-	    fprintf(output, "%s" VFMT, sep, c);
-	    sep = ", ";
-	  }
-	}
+	fprintf(output, "%s{\"low\": " VFMT ", \"high\": " VFMT "}", sep, interval->low, interval->high);
+	sep = ", ";
       }
+    } else {
+      output_shared_successor_list(lists, tc, output, i);
     }
     fprintf(output, "]\n");
     if (i < scc_count - 1) {
@@ -95,28 +244,29 @@ void output_tc_components(TC* tc, FILE* output, enum output_format output_as) {
     }
   }
   fprintf(output, "]\n");
+  if (lists != NULL) {
+    SharedLists_delete(lists);
+  }
 }
 
 /* Output the transitive closure edges FROM_VERTICE,TO_VERTICE as CSV. */
 void output_tc_edges(TC* tc, FILE* output, enum output_format output_as) {
-  SCC** scc_table = tc->scc_table;
   vint scc_count = tc->scc_count;
-  fprintf(output, "from,to\n");
-  for (vint i1 = 0; i1 < scc_count; i1++) {
-    SCC *from_scc = scc_table[i1];
-    for (vint j1 = 0; j1 < from_scc->vertex_count; j1++) {
-      vint from_vertex_id = from_scc->vertex_table[j1];
-      Intervals* intervals = from_scc->successors;
-      if (intervals != NULL) {
-	for (vint k = 0; k < intervals->interval_count; k++) {
-	  Interval *interval = &(intervals->interval_table[k]);
-	  for (vint i2 = interval->low; i2 <= interval->high; i2++) {
-	    SCC *to_scc = scc_table[i2];
-	    for (vint j2 = 0; j2 < to_scc->vertex_count; j2++) {
-	      vint to_vertex_id = to_scc->vertex_table[j2];
-	      fprintf(output, VFMT "," VFMT "\n", from_vertex_id, to_vertex_id);
-	    }
-	  }
+  vint buffer[OUTPUT_BUFFER_SIZE];
+  TCVertexIter iter;
+  fprintf(output, "%s\n", edges_header(tc));
+  for (vint i = 0; i < scc_count; i++) {
+    SCC from_scc = TC_scc_id_to_scc(tc, i);
+    for (vint j = 0; j < from_scc.vertex_count; j++) {
+      vint from_vertex_id = from_scc.vertex_table[j];
+      vint count;
+      TCVertexIter_init(&iter, tc, i);
+      while ((count = TCVertexIter_next(&iter, buffer, OUTPUT_BUFFER_SIZE)) > 0) {
+	for (vint k = 0; k < count; k++) {
+	  output_vertex(tc, output, from_vertex_id, 0);
+	  putc(',', output);
+	  output_vertex(tc, output, buffer[k], 0);
+	  putc('\n', output);
 	}
       }
     }
@@ -125,32 +275,159 @@ void output_tc_edges(TC* tc, FILE* output, enum output_format output_as) {
 
 /* Output the transitive closure edges FROM_COMPONENT,TO_COMPONENT as CSV. */
 void output_tc_component_edges(TC* tc, FILE* output, enum output_format output_as) {
-  SCC** components = tc->scc_table;
   vint scc_count = tc->scc_count;
-  fprintf(output, "from,to\n");
+  vint buffer[OUTPUT_BUFFER_SIZE];
+  TCSCCIter iter;
+  fprintf(output, "%s\n", edges_header(tc));
   for (vint i = 0; i < scc_count; i++) {
-    SCC *scc = components[i];
-    vint from_id = scc->scc_id;
-    Intervals* intervals = scc->successors;
-    if (intervals != NULL) {
-      for (vint j = 0; j < intervals->interval_count; j++) {
-	Interval *interval = &(intervals->interval_table[j]);
-	for (vint to_id = interval->low; to_id <= interval->high; to_id++) {
-	  fprintf(output, VFMT "," VFMT "\n", from_id, to_id);
-	}
+    vint count;
+    TCSCCIter_init(&iter, tc, i);
+    while ((count = TCSCCIter_next(&iter, buffer, OUTPUT_BUFFER_SIZE)) > 0) {
+      for (vint k = 0; k < count; k++) {
+	fprintf(output, VFMT "," VFMT "\n", i, buffer[k]);
       }
     }
   }
 }
 
-/* The output main function. */
-void output_result(TC* result, char* output_file, enum output_format output_as) {
+/* Output the transitive reduction of the digraph as JSON. For each cyclic
+   strong component, "cycle" lists its vertices v[0], ..., v[n-1] in the
+   order of its vertex table. They stand for a synthetic cycle of new edges
+   v[i] -> v[i+1] and v[n-1] -> v[0] that replaces the internal edges of the
+   component; the edges need not be in the input. The cycle is empty if the
+   component is acyclic. The successors are the adjacent components in the
+   transitive reduction of the condensation graph. The synthetic cycles
+   together with edges from the root of each component to the roots of its
+   successors form a minimal graph with the same transitive closure as the
+   input. */
+void output_tc_reduction(TC* tc, FILE* output, enum output_format output_as) {
+  vint scc_count = tc->scc_count;
+  fprintf(output, "[\n");
+  for (vint i = 0; i < scc_count; i++) {
+    SCC scc = TC_scc_id_to_scc(tc, i);
+    fprintf(output, "    {\n");
+    fprintf(output, "        \"scc\": " VFMT ",\n", i);
+    fprintf(output, "        \"root\": ");
+    output_vertex(tc, output, scc.root_vertex_id, 1);
+    fprintf(output, ",\n");
+    fprintf(output, "        \"cycle\": [");
+    char* sep = "";
+    if (TC_sccs_edge_exists(tc, i, i)) {
+      for (vint j = 0; j < scc.vertex_count; j++) {
+	fputs(sep, output);
+	output_vertex(tc, output, scc.vertex_table[j], 1);
+	sep = ", ";
+      }
+    }
+    fprintf(output, "],\n");
+    fprintf(output, "        \"%s\": [", successors_tag(tc));
+    sep = "";
+    for (vint j = 0; j < scc.adjacent_count; j++) {
+      fprintf(output, "%s" VFMT, sep, scc.adjacent_table[j]);
+      sep = ", ";
+    }
+    fprintf(output, "]\n");
+    fprintf(output, (i < scc_count - 1 ? "    },\n" : "    }\n"));
+  }
+  fprintf(output, "]\n");
+}
+
+/* Output the condensation graph as JSON: the strong component of each vertex
+   and the edges between the components. */
+void output_tc_condensation(TC* tc, FILE* output, enum output_format output_as) {
+  vint n = tc->vertex_id_count;
+  vint scc_count = tc->scc_count;
+  char* from_tag = (tc->reversep ? "to" : "from");
+  char* to_tag = (tc->reversep ? "from" : "to");
+  char* sep = "";
+  fprintf(output, "{\n");
+  fprintf(output, "    \"vertices\": [");
+  for (vint v = 0; v < n; v++) {
+    vint scc_id = TC_vertex_id_to_scc_id(tc, v);
+    if (scc_id < 0) {
+      /* Not reachable from the sources */
+      continue;
+    }
+    fprintf(output, "%s\n        {\"id\": ", sep);
+    output_vertex(tc, output, v, 1);
+    fprintf(output, ", \"scc\": " VFMT "}", scc_id);
+    sep = ",";
+  }
+  fprintf(output, "\n    ],\n");
+  fprintf(output, "    \"edges\": [");
+  sep = "";
+  for (vint i = 0; i < scc_count; i++) {
+    SCC scc = TC_scc_id_to_scc(tc, i);
+    for (vint j = 0; j < scc.adjacent_count; j++) {
+      fprintf(output, "%s\n        {\"%s\": " VFMT ", \"%s\": " VFMT "}", sep, from_tag, i, to_tag, scc.adjacent_table[j]);
+      sep = ",";
+    }
+  }
+  fprintf(output, "\n    ]\n");
+  fprintf(output, "}\n");
+}
+
+/* The estimated sizes of the closure of the digraph as JSON, see
+   estimate_closure. The tc is the condensation of the digraph. */
+void output_tc_estimate(TC* tc, Digraph *g, FILE* output, enum output_format output_as) {
+  ClosureEstimate *estimate = estimate_closure(tc, g);
+  fprintf(output, "{\n");
+  fprintf(output, "    \"sketch_size\": %d,\n", estimate->sketch_size);
+  fprintf(output, "    \"relative_error\": %.3f,\n", estimate->relative_error);
+  fprintf(output, "    \"edges\": %.0f,\n", estimate->edge_count);
+  fprintf(output, "    \"edges_low\": %.0f,\n", estimate->edge_count_low);
+  fprintf(output, "    \"edges_high\": %.0f,\n", estimate->edge_count_high);
+  fprintf(output, "    \"edges_bytes\": %.0f,\n", estimate->edges_bytes);
+  fprintf(output, "    \"vertices_bytes\": %.0f,\n", estimate->vertices_bytes);
+  fprintf(output, "    \"memory_bytes_low\": %.0f,\n", estimate->memory_bytes_low);
+  fprintf(output, "    \"memory_bytes_high\": %.0f,\n", estimate->memory_bytes_high);
+  fprintf(output, "    \"components\": [");
+  char* sep = "";
+  for (vint i = 0; i < tc->scc_count; i++) {
+    fprintf(output, "%s\n        {\"scc\": " VFMT ", \"root\": ", sep, i);
+    output_vertex(tc, output, TC_scc_root(tc, i), 1);
+    fprintf(output, ", \"vertices\": " VFMT ", \"%s\": %.0f, \"exact\": %s}",
+	    TC_scc_vertex_count(tc, i), successors_tag(tc),
+	    estimate->successor_count_table[i], (estimate->exact_table[i] ? "true" : "false"));
+    sep = ",";
+  }
+  fprintf(output, "\n    ]\n");
+  fprintf(output, "}\n");
+  ClosureEstimate_delete(estimate);
+}
+
+/* The output file, stdout if output_file is NULL or "-". Returns NULL if the
+   file cannot be opened. */
+static FILE *open_output(char* output_file) {
   FILE* output;
-  if (output_file == NULL) {
+  if (output_file == NULL || !strcmp(output_file, "-")) {
     output = stdout;
   } else if (!(output = fopen(output_file, "w"))) {
-      fprintf(stderr, "Cannot open output file %s\n", output_file);
-      exit(1);
+    fprintf(stderr, "Cannot open output file %s\n", output_file);
+  }
+  return output;
+}
+
+/* Returns 0 if the output could not be written */
+static int close_output(FILE* output, char* output_file) {
+  int failedp = ferror(output);
+  if (output != stdout) {
+    failedp = (fclose(output) != 0) || failedp;
+  } else {
+    failedp = (fflush(output) != 0) || failedp;
+  }
+  if (failedp) {
+    fprintf(stderr, "Cannot write output file %s\n", (output == stdout ? "-" : output_file));
+  }
+  return !failedp;
+}
+
+/* The output main function. The digraph is needed only by output_estimate.
+   Returns 0 if the output file cannot be opened or written. */
+int output_result(TC* result, Digraph *g, char* output_file, enum output_format output_as) {
+  FILE* output = open_output(output_file);
+  if (output == NULL) {
+    return 0;
   }
   switch (output_as) {
   case output_vertices:
@@ -165,12 +442,40 @@ void output_result(TC* result, char* output_file, enum output_format output_as)
     break;
   case output_component_edges:
     output_tc_component_edges(result, output, output_as);
+    break;
+  case output_reduction:
+    output_tc_reduction(result, output, output_as);
+    break;
+  case output_condensation:
+    output_tc_condensation(result, output, output_as);
+    break;
+  case output_estimate:
+    output_tc_estimate(result, g, output, output_as);
+    break;
   case output_nothing:
     break;
   }
-  if (output != stdout) {
-    fclose(output);
+  return close_output(output, output_file);
+}
+
+/* The targets reachable from any of the sources as a one-column csv file,
+   see TC_reachable_targets. Returns 0 if the output file cannot be opened or
+   written. */
+int output_reachable_targets(TC* result, char* output_file, vint *sources, vint source_count,
+			     vint *targets, vint target_count) {
+  FILE* output = open_output(output_file);
+  if (output == NULL) {
+    return 0;
+  }
+  vint *reachable = NEWN(vint, target_count);
+  vint count = TC_reachable_targets(result, sources, source_count, targets, target_count, 0, reachable);
+  fputs("vertex\n", output);
+  for (vint i = 0; i < count; i++) {
+    output_vertex(result, output, reachable[i], 0);
+    fputc('\n', output);
   }
+  DELETE(reachable);
+  return close_output(output, output_file);
 }
 
 void output_matrix(Matrix *matrix, FILE *output) {
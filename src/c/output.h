@@ -26,7 +26,16 @@ void output_tc_edges(TC* tc, FILE* output, enum output_format output_as);
 
 void output_tc_component_edges(TC* tc, FILE* output, enum output_format output_as);
 
-void output_result(TC* result, char* output_file, enum output_format output_as);
+void output_tc_reduction(TC* tc, FILE* output, enum output_format output_as);
+
+void output_tc_condensation(TC* tc, FILE* output, enum output_format output_as);
+
+void output_tc_estimate(TC* tc, Digraph *g, FILE* output, enum output_format output_as);
+
+int output_result(TC* result, Digraph *g, char* output_file, enum output_format output_as);
+
+int output_reachable_targets(TC* result, char* output_file, vint *sources, vint source_count,
+			     vint *targets, vint target_count);
 
 void output_matrix(Matrix *matrix, FILE *output);
 
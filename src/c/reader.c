@@ -0,0 +1,589 @@
+/*
+  =============================================================================
+  Author:  Esko Nuutila (enu@iki.fi)
+  Date:    2017-06-23
+  Date:    2022-07-12
+  Licence: MIT
+  =============================================================================
+  File: reader.c
+
+  Reading the edges of the input graph from a csv file.
+  =============================================================================
+*/
+
+#include "reader.h"
+#include "labels.h"
+#include "idmap.h"
+#include "compressed.h"
+#include <ctype.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* A chunk parsed by a thread of its own should be at least this large */
+#define READER_MIN_CHUNK_SIZE (1 << 20)
+/* The size of the blocks read from a stream */
+#define READER_BLOCK_SIZE (1 << 20)
+/* The smallest run of spilled edges */
+#define READER_MIN_RUN_EDGES 1024
+
+/* The edges are spilled after memory_budget bytes, see EdgeBuffer_spill_to */
+static char *spill_directory = NULL;
+static size_t spill_memory_budget = 0;
+
+/* ==== Parsing the lines ==== */
+
+/* Remove the white space around a field. Returns the new length. */
+size_t trim_field(char **field, size_t length) {
+  char *start = *field;
+  while (length > 0 && isspace((unsigned char)start[0])) {
+    start++;
+    length--;
+  }
+  while (length > 0 && isspace((unsigned char)start[length - 1])) {
+    length--;
+  }
+  *field = start;
+  return length;
+}
+
+/* Parse a trimmed field containing a non-negative decimal number. Returns -1
+   if the field is not such a number. */
+vint parse_number(char *field, size_t length) {
+  vint result = 0;
+  if (length == 0) {
+    return -1;
+  }
+  for (size_t i = 0; i < length; i++) {
+    unsigned digit = (unsigned char)field[i] - '0';
+    if (digit > 9 || result > (LONG_MAX - digit)/10) {
+      return -1;
+    }
+    result = result*10 + digit;
+  }
+  return result;
+}
+
+/* The buffer is one of buffer_count buffers sharing the memory budget */
+static void EdgeBuffer_init(EdgeBuffer *this, int buffer_count) {
+  this->edge_size = 1024;
+  this->edges = NEWN(EDGE, this->edge_size);
+  this->edge_count = 0;
+  this->max_vertex = -1;
+  this->line_count = 0;
+  this->error_line = -1;
+  this->error_text = NULL;
+  this->spill_limit = 0;
+  this->id_map = NULL;
+  this->run_fd = -1;
+  this->run_file_size = 0;
+  this->run_length_table = NULL;
+  this->run_count = 0;
+  if (spill_directory != NULL) {
+    this->spill_limit = spill_memory_budget/buffer_count/sizeof(EDGE);
+    if (this->spill_limit < READER_MIN_RUN_EDGES) {
+      this->spill_limit = READER_MIN_RUN_EDGES;
+    }
+  }
+}
+
+void EdgeBuffer_delete(EdgeBuffer *this) {
+  DELETE(this->edges);
+  DELETE(this->error_text);
+  DELETE(this->run_length_table);
+  if (this->run_fd >= 0) {
+    close(this->run_fd);
+  }
+}
+
+/* ==== Spilling the edges to sorted runs ==== */
+
+/* Spill the edges to unnamed files in the directory after memory_budget
+   bytes of them are in memory. Returns 0 if the directory is not writable. */
+int EdgeBuffer_spill_to(char *directory, size_t memory_budget) {
+  if (access(directory, W_OK) != 0) {
+    return 0;
+  }
+  spill_directory = directory;
+  spill_memory_budget = memory_budget;
+  return 1;
+}
+
+static int cmp_edge(const void *a, const void *b) {
+  EDGE *e = (EDGE*)a;
+  EDGE *f = (EDGE*)b;
+  if (e->from != f->from) {
+    return (e->from < f->from ? -1 : 1);
+  }
+  return (e->to < f->to ? -1 : e->to > f->to ? 1 : 0);
+}
+
+/* Sort the edges of the buffer and append them as a run to its file. The
+   sparse numbers are interned first, in the order of the input. */
+static void EdgeBuffer_spill(EdgeBuffer *this) {
+  if (this->run_fd < 0) {
+    char *path = NEWN(char, strlen(spill_directory) + sizeof("/stacktc-edges-XXXXXX"));
+    sprintf(path, "%s/stacktc-edges-XXXXXX", spill_directory);
+    if ((this->run_fd = mkstemp(path)) < 0) {
+      perror("Cannot create an edge run file");
+      exit(1);
+    }
+    /* The file is removed when it is closed */
+    unlink(path);
+    DELETE(path);
+  }
+  if (this->id_map != NULL) {
+    for (vint i = 0; i < this->edge_count; i++) {
+      this->edges[i].from = IdMap_intern(this->id_map, this->edges[i].from);
+      this->edges[i].to = IdMap_intern(this->id_map, this->edges[i].to);
+    }
+  }
+  qsort(this->edges, this->edge_count, sizeof(EDGE), &cmp_edge);
+  char *bytes = (char*)this->edges;
+  size_t left = sizeof(EDGE)*this->edge_count;
+  while (left > 0) {
+    ssize_t written = write(this->run_fd, bytes, left);
+    if (written < 0) {
+      perror("Cannot write an edge run file");
+      exit(1);
+    }
+    bytes += written;
+    left -= written;
+  }
+  this->run_file_size += sizeof(EDGE)*this->edge_count;
+  this->run_length_table = realloc(this->run_length_table, sizeof(vint)*(this->run_count + 1));
+  this->run_length_table[this->run_count++] = this->edge_count;
+  this->edge_count = 0;
+}
+
+/* The next edges of the runs in merge_edges */
+typedef struct edge_cursor_struct {
+  EDGE *next;
+  EDGE *limit;
+} EdgeCursor;
+
+static int edge_less(EDGE *e, EDGE *f) {
+  return (e->from < f->from || (e->from == f->from && e->to < f->to));
+}
+
+static void sift_down_edges(EdgeCursor *heap, vint count, vint i) {
+  EdgeCursor cursor = heap[i];
+  while (2*i + 1 < count) {
+    vint child = 2*i + 1;
+    if (child + 1 < count && edge_less(heap[child + 1].next, heap[child].next)) {
+      child++;
+    }
+    if (!edge_less(heap[child].next, cursor.next)) {
+      break;
+    }
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = cursor;
+}
+
+/* Merge the spilled runs and the sorted rest of the buffers in the order of
+   the edges. The targets are stored to children, thus sorted for each
+   vertex, and the outdegrees are counted. The run files are mapped to
+   memory, so that the kernel reads them ahead and drops the pages already
+   merged. Returns the number of edges. */
+vint merge_edges(EdgeBuffer *buffers, int buffer_count, vint *children, vint *outdegrees) {
+  vint run_count = 0;
+  for (int i = 0; i < buffer_count; i++) {
+    run_count += buffers[i].run_count + 1;
+  }
+  EdgeCursor *heap = NEWN(EdgeCursor, run_count);
+  EDGE **mappings = NEWN(EDGE*, buffer_count);
+  vint count = 0;
+  for (int i = 0; i < buffer_count; i++) {
+    EdgeBuffer *buffer = &(buffers[i]);
+    mappings[i] = NULL;
+    if (buffer->run_file_size > 0) {
+      mappings[i] = (EDGE*)mmap(NULL, buffer->run_file_size, PROT_READ, MAP_PRIVATE, buffer->run_fd, 0);
+      if (mappings[i] == MAP_FAILED) {
+	perror("Cannot map an edge run file");
+	exit(1);
+      }
+      madvise(mappings[i], buffer->run_file_size, MADV_SEQUENTIAL);
+    }
+    EDGE *run = mappings[i];
+    for (vint r = 0; r < buffer->run_count; r++) {
+      heap[count].next = run;
+      heap[count].limit = run + buffer->run_length_table[r];
+      run = heap[count++].limit;
+    }
+    if (buffer->edge_count > 0) {
+      qsort(buffer->edges, buffer->edge_count, sizeof(EDGE), &cmp_edge);
+      heap[count].next = buffer->edges;
+      heap[count++].limit = buffer->edges + buffer->edge_count;
+    }
+  }
+  for (vint i = count/2 - 1; i >= 0; i--) {
+    sift_down_edges(heap, count, i);
+  }
+  vint edge_count = 0;
+  while (count > 0) {
+    EDGE *edge = heap[0].next++;
+    children[edge_count++] = edge->to;
+    outdegrees[edge->from]++;
+    if (heap[0].next == heap[0].limit) {
+      heap[0] = heap[--count];
+    }
+    if (count > 0) {
+      sift_down_edges(heap, count, 0);
+    }
+  }
+  for (int i = 0; i < buffer_count; i++) {
+    if (mappings[i] != NULL) {
+      munmap(mappings[i], buffers[i].run_file_size);
+    }
+  }
+  DELETE(mappings);
+  DELETE(heap);
+  return edge_count;
+}
+
+static void EdgeBuffer_add(EdgeBuffer *this, vint from_vertex, vint to_vertex) {
+  if (this->edge_count == this->edge_size) {
+    if (this->spill_limit > 0 && this->edge_count >= this->spill_limit) {
+      EdgeBuffer_spill(this);
+    } else {
+      this->edge_size *= 2;
+      if (this->spill_limit > 0 && this->edge_size > this->spill_limit) {
+	this->edge_size = this->spill_limit;
+      }
+      this->edges = (EDGE*)realloc(this->edges, sizeof(EDGE)*this->edge_size);
+    }
+  }
+  this->edges[this->edge_count].from = from_vertex;
+  this->edges[this->edge_count].to = to_vertex;
+  this->edge_count++;
+  if (from_vertex > this->max_vertex) {
+    this->max_vertex = from_vertex;
+  }
+  if (to_vertex > this->max_vertex) {
+    this->max_vertex = to_vertex;
+  }
+}
+
+/* Parse a vertex field of an edge line. Labels are interned, numbers are
+   used as such. Returns -1 if the field is not a legal vertex. */
+static vint parse_vertex(char *field, size_t length, enum input_format input_as, Labels *labels) {
+  length = trim_field(&field, length);
+  if (length == 0) {
+    return -1;
+  } else if (input_as == input_labels) {
+    return Labels_intern(labels, field, length);
+  } else {
+    return parse_number(field, length);
+  }
+}
+
+/* Parse the lines between begin and end to the buffer. The last line need not
+   end with a newline. Empty lines and lines starting with '#' are ignored.
+   Stops at the first illegal line and returns 0; otherwise returns 1. */
+static int parse_edges(EdgeBuffer *this, char *begin, char *end, enum input_format input_as, Labels *labels) {
+  while (begin < end) {
+    char *newline = memchr(begin, '\n', end - begin);
+    char *line_end = (newline != NULL ? newline : end);
+    char *field = begin;
+    size_t length = trim_field(&field, line_end - begin);
+    begin = (newline != NULL ? newline + 1 : end);
+    this->line_count++;
+    if (length == 0 || field[0] == '#') {
+      continue;
+    }
+    char *comma = memchr(field, ',', length);
+    vint from_vertex, to_vertex;
+    if (comma == NULL
+	|| (from_vertex = parse_vertex(field, comma - field, input_as, labels)) < 0
+	|| (to_vertex = parse_vertex(comma + 1, field + length - comma - 1, input_as, labels)) < 0) {
+      this->error_line = this->line_count;
+      this->error_text = strndup(field, length);
+      return 0;
+    }
+    EdgeBuffer_add(this, from_vertex, to_vertex);
+  }
+  return 1;
+}
+
+/* ==== Parsing a memory mapped file in parallel ==== */
+
+typedef struct chunk_struct {
+  EdgeBuffer *buffer;
+  char *begin;
+  char *end;
+  enum input_format input_as;
+} Chunk;
+
+static void *parse_chunk(void *arg) {
+  Chunk *chunk = (Chunk*)arg;
+  parse_edges(chunk->buffer, chunk->begin, chunk->end, chunk->input_as, NULL);
+  return NULL;
+}
+
+/* Split the lines between begin and end into chunk_count chunks and parse
+   them in parallel. */
+static void parse_chunks(EdgeBuffer *buffers, int chunk_count, char *begin, char *end, enum input_format input_as) {
+  Chunk *chunks = NEWN(Chunk, chunk_count);
+  pthread_t *threads = NEWN(pthread_t, chunk_count);
+  size_t size = end - begin;
+  char *chunk_begin = begin;
+  for (int i = 0; i < chunk_count; i++) {
+    char *chunk_end = (i == chunk_count - 1 ? end : begin + size/chunk_count*(i + 1));
+    if (chunk_end < chunk_begin) {
+      chunk_end = chunk_begin;
+    } else if (chunk_end < end) {
+      char *newline = memchr(chunk_end, '\n', end - chunk_end);
+      chunk_end = (newline != NULL ? newline + 1 : end);
+    }
+    EdgeBuffer_init(&(buffers[i]), chunk_count);
+    chunks[i].buffer = &(buffers[i]);
+    chunks[i].begin = chunk_begin;
+    chunks[i].end = chunk_end;
+    chunks[i].input_as = input_as;
+    chunk_begin = chunk_end;
+  }
+  for (int i = 1; i < chunk_count; i++) {
+    if (pthread_create(&(threads[i]), NULL, &parse_chunk, &(chunks[i]))) {
+      fprintf(stderr, "Cannot create a thread for parsing\n");
+      exit(1);
+    }
+  }
+  parse_chunk(&(chunks[0]));
+  for (int i = 1; i < chunk_count; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  DELETE(threads);
+  DELETE(chunks);
+}
+
+/* Check that the first line of the input is a header line naming the two
+   fields. Returns the start of the second line or NULL. */
+static char *skip_header(char *begin, char *end) {
+  char *newline = memchr(begin, '\n', end - begin);
+  char *line_end = (newline != NULL ? newline : end);
+  if (memchr(begin, ',', line_end - begin) == NULL) {
+    return NULL;
+  }
+  return (newline != NULL ? newline + 1 : end);
+}
+
+/* A single edge buffer telling that the input has no header line */
+static EdgeBuffer *header_error(int *buffer_count) {
+  EdgeBuffer *buffer = NEW(EdgeBuffer);
+  EdgeBuffer_init(buffer, 1);
+  buffer->error_line = 0;
+  *buffer_count = 1;
+  return buffer;
+}
+
+static EdgeBuffer *read_edges_mapped(int fd, size_t size, enum input_format input_as, int thread_count,
+				     Labels *labels, IdMap *id_map, int *buffer_count) {
+  char *begin = (char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  char *end = begin + size;
+  char *body;
+  EdgeBuffer *buffers;
+  if (begin == MAP_FAILED) {
+    return NULL;
+  }
+  madvise(begin, size, MADV_SEQUENTIAL);
+  if (!(body = skip_header(begin, end))) {
+    munmap(begin, size);
+    return header_error(buffer_count);
+  }
+  /* The labels are interned in the order they are met, thus by one thread.
+     So are the sparse numbers of spilled edges. */
+  vint chunk_count = (end - body)/READER_MIN_CHUNK_SIZE + 1;
+  if (input_as == input_labels || (id_map != NULL && spill_directory != NULL)) {
+    chunk_count = 1;
+  } else if (chunk_count > thread_count) {
+    chunk_count = thread_count;
+  }
+  buffers = NEWN(EdgeBuffer, chunk_count);
+  if (chunk_count == 1) {
+    EdgeBuffer_init(buffers, 1);
+    buffers->id_map = id_map;
+    parse_edges(buffers, body, end, input_as, labels);
+  } else {
+    parse_chunks(buffers, chunk_count, body, end, input_as);
+  }
+  munmap(begin, size);
+  *buffer_count = chunk_count;
+  return buffers;
+}
+
+/* ==== Parsing a stream ==== */
+
+/* A stream is either a plain or a compressed input. The prefix contains the
+   bytes read from the input while detecting the compression. */
+typedef struct stream_struct {
+  FILE *input;
+  char *prefix;
+  size_t prefix_length;
+  CompressedStream *compressed;
+} Stream;
+
+static size_t Stream_read(Stream *this, char *buffer, size_t size) {
+  size_t got = 0;
+  if (this->compressed != NULL) {
+    return CompressedStream_read(this->compressed, buffer, size);
+  }
+  if (this->prefix_length > 0) {
+    got = (this->prefix_length < size ? this->prefix_length : size);
+    memcpy(buffer, this->prefix, got);
+    this->prefix += got;
+    this->prefix_length -= got;
+  }
+  return got + fread(buffer + got, 1, size - got, this->input);
+}
+
+/* Read the stream in blocks and parse the complete lines of each block. The
+   incomplete last line is moved to the start of the next block. */
+static EdgeBuffer *read_edges_stream(Stream *input, enum input_format input_as, Labels *labels, IdMap *id_map,
+				     int *buffer_count) {
+  size_t block_size = READER_BLOCK_SIZE;
+  char *block = NEWN(char, block_size);
+  size_t carry = 0;
+  int header_read = 0;
+  int eof = 0;
+  EdgeBuffer *buffer = NEW(EdgeBuffer);
+  EdgeBuffer_init(buffer, 1);
+  buffer->id_map = id_map;
+  while (!eof) {
+    if (carry == block_size) {
+      /* A line longer than a block */
+      block_size *= 2;
+      block = (char*)realloc(block, block_size);
+    }
+    size_t got = Stream_read(input, block + carry, block_size - carry);
+    char *begin = block;
+    char *end = block + carry + got;
+    eof = (got == 0);
+    if (!header_read) {
+      char *newline = memchr(begin, '\n', end - begin);
+      if (newline == NULL && !eof) {
+	carry = end - begin;
+	continue;
+      }
+      if (!(begin = skip_header(begin, end))) {
+	break;
+      }
+      header_read = 1;
+    }
+    char *parse_end = end;
+    if (!eof) {
+      while (parse_end > begin && parse_end[-1] != '\n') {
+	parse_end--;
+      }
+    }
+    if (!parse_edges(buffer, begin, parse_end, input_as, labels)) {
+      break;
+    }
+    carry = end - parse_end;
+    memmove(block, parse_end, carry);
+  }
+  DELETE(block);
+  if (!header_read) {
+    EdgeBuffer_delete(buffer);
+    DELETE(buffer);
+    return header_error(buffer_count);
+  }
+  *buffer_count = 1;
+  return buffer;
+}
+
+/* ==== Reading the edges ==== */
+
+/* Read the edges of the input file (stdin if input_file is NULL or "-") to
+   edge buffers. The input may be gzip or zstd compressed. The vertices are either non-negative integers or labels, that
+   is, arbitrary strings without commas. The labels get the ids 0, 1, ... in
+   the order they are met. So do the sparse numbers, so that the tables indexed
+   by vertex ids stay small even if the numbers are huge. Returns NULL if the
+   input cannot be read or contains an illegal line. */
+EdgeBuffer *read_edges(char *input_file, enum input_format input_as, int thread_count,
+		       Labels *labels, IdMap *id_map, int *buffer_count) {
+  EdgeBuffer *buffers = NULL;
+  struct stat input_stat;
+  char magic[COMPRESSION_MAGIC_LENGTH];
+  int decompressed = 1;
+  FILE *input;
+  if (input_file == NULL || !strcmp(input_file, "-")) {
+    input = stdin;
+  } else if (!(input = fopen(input_file, "r"))) {
+    fprintf(stderr, "Cannot open input file %s\n", input_file);
+    return NULL;
+  }
+  size_t magic_length = fread(magic, 1, COMPRESSION_MAGIC_LENGTH, input);
+  enum compression compression = detect_compression(magic, magic_length);
+  if (!compression_supported(compression)) {
+    fprintf(stderr, "Input file %s is compressed, but this build does not support its compression\n",
+	    (input == stdin ? "-" : input_file));
+    if (input != stdin) {
+      fclose(input);
+    }
+    return NULL;
+  }
+  if (compression == compression_none && input != stdin
+      && !fstat(fileno(input), &input_stat) && S_ISREG(input_stat.st_mode) && input_stat.st_size > 0) {
+    buffers = read_edges_mapped(fileno(input), input_stat.st_size, input_as, thread_count, labels, id_map, buffer_count);
+  }
+  if (buffers == NULL) {
+    Stream stream;
+    stream.input = input;
+    stream.prefix = magic;
+    stream.prefix_length = magic_length;
+    stream.compressed = NULL;
+    if (compression != compression_none) {
+      stream.compressed = CompressedStream_open(input, magic, magic_length, compression);
+    }
+    buffers = read_edges_stream(&stream, input_as, labels, id_map, buffer_count);
+    if (stream.compressed != NULL) {
+      decompressed = CompressedStream_close(stream.compressed);
+    }
+  }
+  if (input != stdin) {
+    fclose(input);
+  }
+  if (!decompressed) {
+    for (int j = 0; j < *buffer_count; j++) {
+      EdgeBuffer_delete(&(buffers[j]));
+    }
+    DELETE(buffers);
+    return NULL;
+  }
+  /* The line numbers of the buffers continue from the previous buffers */
+  vint line_number = 1;
+  for (int i = 0; i < *buffer_count; i++) {
+    if (buffers[i].error_line == 0) {
+      fprintf(stderr, "Could not read first line\n");
+    } else if (buffers[i].error_line > 0) {
+      fprintf(stderr, "Illegal edge at line " VFMT ": %s\n", line_number + buffers[i].error_line, buffers[i].error_text);
+    }
+    if (buffers[i].error_line >= 0) {
+      for (int j = 0; j < *buffer_count; j++) {
+	EdgeBuffer_delete(&(buffers[j]));
+      }
+      DELETE(buffers);
+      return NULL;
+    }
+    line_number += buffers[i].line_count;
+  }
+  if (input_as == input_sparse_numbers) {
+    /* Interning in the order of the input gives the same ids for any number
+       of threads. The spilled edges have already been interned, and the
+       edges in memory come after them in the input. */
+    for (int i = 0; i < *buffer_count; i++) {
+      EdgeBuffer *buffer = &(buffers[i]);
+      for (vint j = 0; j < buffer->edge_count; j++) {
+	buffer->edges[j].from = IdMap_intern(id_map, buffer->edges[j].from);
+	buffer->edges[j].to = IdMap_intern(id_map, buffer->edges[j].to);
+      }
+      buffer->max_vertex = id_map->id_count - 1;
+    }
+  }
+  return buffers;
+}
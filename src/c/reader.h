@@ -0,0 +1,43 @@
+/*
+  =============================================================================
+  Author:  Esko Nuutila (enu@iki.fi)
+  Date:    2017-06-23
+  Date:    2022-07-12
+  Licence: MIT
+  =============================================================================
+  File: reader.h
+
+  Reading the edges of the input graph from a csv file.
+
+  A regular file is mapped to memory and split at line boundaries into
+  chunks that are parsed in parallel, each into its own edge buffer. Other
+  inputs, such as pipes, are read in blocks and parsed by a single thread.
+  So are compressed inputs, which are decompressed by another thread while
+  parsing (see compressed.h).
+  The edge buffers are in the order of the input, so that the line numbers of
+  illegal lines can be computed from the line counts of the buffers.
+
+  If the edges do not fit in memory, the buffers can spill them to temporary
+  files after a memory budget (see EdgeBuffer_spill_to). Each full buffer is
+  sorted and written as a run, and the runs and the rest of the buffers are
+  merged into the children table of the digraph (see merge_edges).
+  =============================================================================
+*/
+
+#ifndef _reader_h_
+#define _reader_h_
+
+#include "types.h"
+#include "macros.h"
+#include "util.h"
+
+size_t trim_field(char **field, size_t length);
+vint parse_number(char *field, size_t length);
+
+EdgeBuffer *read_edges(char *input_file, enum input_format input_as, int thread_count,
+		       Labels *labels, IdMap *id_map, int *buffer_count);
+void EdgeBuffer_delete(EdgeBuffer *this);
+int EdgeBuffer_spill_to(char *directory, size_t memory_budget);
+vint merge_edges(EdgeBuffer *buffers, int buffer_count, vint *children, vint *outdegrees);
+
+#endif
@@ -17,8 +17,7 @@
 #include "macros.h"
 #include "util.h"
 
-SCC *SCC_new(vint scc_id, vint root_vertex_id, vint *vertex_table);
-vint SCC_successor_scc_count(SCC *this);
+vint SCC_successor_scc_count(TC* tc, vint scc_id);
 vint SCC_successor_vertex_count(TC* tc, vint scc_id);
 
 #endif
@@ -0,0 +1,120 @@
+/*
+  =============================================================================
+  Author:  Esko Nuutila (enu@iki.fi)
+  Date:    2017-06-23
+  Date:    2022-07-12
+  Licence: MIT
+  =============================================================================
+  File: stacktc.h
+
+  The public interface of the library libstacktc. A digraph is built from
+  tables of edges, its transitive closure is computed, and the closure is
+  queried and iterated without going through files. This header does not
+  depend on the other headers of stacktc, and the types are opaque, so
+  programs using it need not be recompiled when the implementation changes.
+
+  The vertices are the numbers 0..vertex_count-1. The strong components are
+  numbered in the order they are completed, so that the successors of a
+  component have smaller numbers than the component itself (unless they are
+  in the same component).
+
+  Each thread has its own working storage, so closures can be computed in
+  several threads at the same time. The storage is kept for the next
+  computation of the thread until stacktc_closure_free_workspace is called.
+  A computed closure is independent of its digraph and of other closures,
+  and it may be queried from several threads.
+  =============================================================================
+*/
+
+#ifndef _stacktc_h_
+#define _stacktc_h_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef long stacktc_id;
+
+/* The successor set of a component is a sorted table of disjoint intervals
+   of component numbers. */
+typedef struct stacktc_interval {
+  stacktc_id low;
+  stacktc_id high;
+} stacktc_interval;
+
+typedef struct digraph_struct stacktc_graph;
+typedef struct tc_struct stacktc_closure;
+typedef struct tc_iter_struct stacktc_iterator;
+
+/* Build a digraph of the edges from[i] -> to[i], 0 <= i < edge_count. The
+   tables are copied. If vertex_count is negative, it is the largest vertex
+   in the edges plus one. Returns NULL if a vertex is negative or not less
+   than vertex_count. */
+stacktc_graph *stacktc_graph_new(const stacktc_id *from, const stacktc_id *to, stacktc_id edge_count, stacktc_id vertex_count);
+void stacktc_graph_free(stacktc_graph *graph);
+stacktc_id stacktc_graph_vertex_count(const stacktc_graph *graph);
+stacktc_id stacktc_graph_edge_count(const stacktc_graph *graph);
+
+/* Compute the transitive closure of the digraph */
+stacktc_closure *stacktc_closure_new(const stacktc_graph *graph);
+void stacktc_closure_free(stacktc_closure *closure);
+void stacktc_closure_free_workspace(void);
+stacktc_id stacktc_closure_vertex_count(const stacktc_closure *closure);
+stacktc_id stacktc_closure_component_count(const stacktc_closure *closure);
+
+/* The strong component of a vertex, or -1 if the vertex is not in the digraph */
+stacktc_id stacktc_closure_component(const stacktc_closure *closure, stacktc_id vertex);
+
+/* 1 if there is a non-empty path from the vertex from to the vertex to,
+   otherwise 0 */
+int stacktc_closure_reachable(const stacktc_closure *closure, stacktc_id from, stacktc_id to);
+int stacktc_closure_components_reachable(const stacktc_closure *closure, stacktc_id from_component, stacktc_id to_component);
+
+/* Store to result[i] 1 if there is a non-empty path from from[i] to to[i],
+   otherwise 0, for 0 <= i < count. Returns 0 if a vertex does not exist,
+   otherwise 1. */
+int stacktc_closure_reachable_pairs(const stacktc_closure *closure, const stacktc_id *from, const stacktc_id *to,
+				    stacktc_id count, unsigned char *result);
+
+/* Copy the large successor sets to a layout that is faster to search, so
+   that the two functions above are faster when they are called many times.
+   This needs about as much memory again as the successor sets. */
+void stacktc_closure_build_index(stacktc_closure *closure);
+
+/* Store to result the targets reachable from any of the sources, in the
+   order of the targets. The result table must have room for target_count
+   vertices. Returns the number of vertices stored, or -1 if a vertex does
+   not exist. */
+stacktc_id stacktc_closure_reachable_targets(const stacktc_closure *closure,
+					     const stacktc_id *sources, stacktc_id source_count,
+					     const stacktc_id *targets, stacktc_id target_count,
+					     stacktc_id *result);
+
+/* The tables of a component are returned without copying and are valid
+   until the closure is freed. The functions return the length of the table,
+   or -1 if the component does not exist. */
+stacktc_id stacktc_closure_component_vertices(const stacktc_closure *closure, stacktc_id component, const stacktc_id **vertices);
+stacktc_id stacktc_closure_component_intervals(const stacktc_closure *closure, stacktc_id component, const stacktc_interval **intervals);
+
+/* The tables of the whole closure, without copying. The component table
+   has the component of each vertex, vertex_count in all. The vertex table
+   has the vertices of the components one after another, and the vertices
+   of the component i are from offsets[i] to offsets[i+1]-1. */
+const stacktc_id *stacktc_closure_component_table(const stacktc_closure *closure);
+const stacktc_id *stacktc_closure_vertex_table(const stacktc_closure *closure, const stacktc_id **offsets);
+
+/* Iterate over the successor vertices of a vertex or the successor
+   components of a component. stacktc_iterator_next fills the buffer with at
+   most buffer_size successors and returns their number, 0 at the end.
+   The constructors return NULL if the vertex or the component does not
+   exist. */
+stacktc_iterator *stacktc_iterator_vertex_successors(const stacktc_closure *closure, stacktc_id vertex);
+stacktc_iterator *stacktc_iterator_component_successors(const stacktc_closure *closure, stacktc_id component);
+stacktc_id stacktc_iterator_next(stacktc_iterator *iterator, stacktc_id *buffer, stacktc_id buffer_size);
+void stacktc_iterator_free(stacktc_iterator *iterator);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,163 @@
+/*
+  =============================================================================
+  Author:  Esko Nuutila (enu@iki.fi)
+  Date:    2017-06-23
+  Date:    2022-07-12
+  Licence: MIT
+  =============================================================================
+  File: stacktc.hpp
+
+  A thin C++20 wrapper of the library interface in stacktc.h. The objects
+  own their handles and can be moved but not copied. The tables of a
+  closure are returned as std::span views of the library's own storage,
+  valid as long as the closure exists.
+  =============================================================================
+*/
+
+#ifndef _stacktc_hpp_
+#define _stacktc_hpp_
+
+#include "stacktc.h"
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace stacktc {
+
+using id = stacktc_id;
+using interval = stacktc_interval;
+
+class graph {
+public:
+  /* The edges from[i] -> to[i]. If vertex_count is negative, it is the
+     largest vertex plus one. */
+  graph(std::span<const id> from, std::span<const id> to, id vertex_count = -1) {
+    if (from.size() != to.size()) {
+      throw std::invalid_argument("stacktc::graph: from and to differ in length");
+    }
+    handle_ = stacktc_graph_new(from.data(), to.data(), static_cast<id>(from.size()), vertex_count);
+    if (handle_ == nullptr) {
+      throw std::out_of_range("stacktc::graph: vertex out of range");
+    }
+  }
+  graph(const graph &) = delete;
+  graph &operator=(const graph &) = delete;
+  graph(graph &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+  graph &operator=(graph &&other) noexcept {
+    std::swap(handle_, other.handle_);
+    return *this;
+  }
+  ~graph() { stacktc_graph_free(handle_); }
+
+  id vertex_count() const { return stacktc_graph_vertex_count(handle_); }
+  id edge_count() const { return stacktc_graph_edge_count(handle_); }
+  const stacktc_graph *get() const noexcept { return handle_; }
+
+private:
+  stacktc_graph *handle_;
+};
+
+class closure {
+public:
+  /* The closure does not refer to the graph after it has been computed */
+  explicit closure(const graph &g) : handle_(stacktc_closure_new(g.get())) {}
+  closure(const closure &) = delete;
+  closure &operator=(const closure &) = delete;
+  closure(closure &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+  closure &operator=(closure &&other) noexcept {
+    std::swap(handle_, other.handle_);
+    return *this;
+  }
+  ~closure() { stacktc_closure_free(handle_); }
+
+  id vertex_count() const { return stacktc_closure_vertex_count(handle_); }
+  id component_count() const { return stacktc_closure_component_count(handle_); }
+  id component(id vertex) const { return stacktc_closure_component(handle_, vertex); }
+  bool reachable(id from, id to) const { return stacktc_closure_reachable(handle_, from, to); }
+  bool components_reachable(id from, id to) const {
+    return stacktc_closure_components_reachable(handle_, from, to);
+  }
+
+  /* Faster reachable and components_reachable for many queries, see stacktc.h */
+  void build_index() { stacktc_closure_build_index(handle_); }
+
+  std::span<const id> vertices(id component) const {
+    const id *table;
+    id count = stacktc_closure_component_vertices(handle_, component, &table);
+    check(count);
+    return {table, static_cast<std::size_t>(count)};
+  }
+
+  /* The successor components of the component as intervals */
+  std::span<const interval> intervals(id component) const {
+    const interval *table;
+    id count = stacktc_closure_component_intervals(handle_, component, &table);
+    check(count);
+    return {table, static_cast<std::size_t>(count)};
+  }
+
+  /* result[i] tells whether there is a non-empty path from from[i] to to[i] */
+  std::vector<unsigned char> reachable(std::span<const id> from, std::span<const id> to) const {
+    if (from.size() != to.size()) {
+      throw std::invalid_argument("stacktc::closure: from and to differ in length");
+    }
+    std::vector<unsigned char> result(from.size());
+    if (!stacktc_closure_reachable_pairs(handle_, from.data(), to.data(), static_cast<id>(from.size()), result.data())) {
+      throw std::out_of_range("stacktc::closure: vertex out of range");
+    }
+    return result;
+  }
+
+  /* The targets reachable from any of the sources, in the order of the targets */
+  std::vector<id> reachable_targets(std::span<const id> sources, std::span<const id> targets) const {
+    std::vector<id> result(targets.size());
+    id count = stacktc_closure_reachable_targets(handle_, sources.data(), static_cast<id>(sources.size()),
+						 targets.data(), static_cast<id>(targets.size()), result.data());
+    if (count < 0) {
+      throw std::out_of_range("stacktc::closure: vertex out of range");
+    }
+    result.resize(static_cast<std::size_t>(count));
+    return result;
+  }
+
+  /* Call f(id) for each successor vertex of the vertex */
+  template <typename F> void for_each_successor(id vertex, F &&f) const {
+    for_each(stacktc_iterator_vertex_successors(handle_, vertex), std::forward<F>(f));
+  }
+
+  /* Call f(id) for each successor component of the component */
+  template <typename F> void for_each_successor_component(id component, F &&f) const {
+    for_each(stacktc_iterator_component_successors(handle_, component), std::forward<F>(f));
+  }
+
+  const stacktc_closure *get() const noexcept { return handle_; }
+
+private:
+  static void check(id count) {
+    if (count < 0) {
+      throw std::out_of_range("stacktc::closure: component out of range");
+    }
+  }
+
+  template <typename F> static void for_each(stacktc_iterator *iterator, F &&f) {
+    if (iterator == nullptr) {
+      throw std::out_of_range("stacktc::closure: vertex or component out of range");
+    }
+    std::unique_ptr<stacktc_iterator, void (*)(stacktc_iterator *)> owner(iterator, &stacktc_iterator_free);
+    id buffer[1024];
+    id count;
+    while ((count = stacktc_iterator_next(iterator, buffer, 1024)) > 0) {
+      for (id i = 0; i < count; i++) {
+	f(buffer[i]);
+      }
+    }
+  }
+
+  stacktc_closure *handle_;
+};
+
+}
+
+#endif
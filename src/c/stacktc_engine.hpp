@@ -0,0 +1,538 @@
+/*
+  =============================================================================
+  Author:  Esko Nuutila (enu@iki.fi)
+  Date:    2017-06-23
+  Date:    2022-07-12
+  Licence: MIT
+  =============================================================================
+  File: stacktc_engine.hpp
+
+  A header-only C++20 version of the algorithm stacktc (see algorithm.c) in
+  which the vertex and component ids and the successor set representation
+  are template parameters. Each combination is compiled to its own closure
+  loop with the set operations inlined.
+
+  The id type Id is an unsigned integer type, for example std::uint32_t for
+  graphs with less than 2^32 vertices and edges. The set policies are
+
+    interval_sets<Id>    Intervals of component ids as in intervals.c.
+                         The best choice for most graphs.
+    bit_sets<Id>         Bit vectors. As the successors of a component have
+                         smaller ids, the set of component c has c+1 bits.
+                         Fast for small graphs, quadratic memory.
+    compressed_sets<Id>  Sorted component ids stored as variable length
+                         differences. Small when the sets are sparse and
+                         do not form intervals, but lookups are linear.
+
+  closure<Id, Sets> computes the closure of a digraph<Id>. The function
+  compute chooses the id type and the set policy based on the size of the
+  graph, unless the policy is given, and returns the closure behind the
+  virtual interface any_closure.
+  =============================================================================
+*/
+
+#ifndef _stacktc_engine_hpp_
+#define _stacktc_engine_hpp_
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stacktc::engine {
+
+/* ==== Digraphs ==== */
+
+/* A digraph in compressed sparse row form. The children of vertex v are
+   children[offsets[v]..offsets[v+1]-1]. */
+template <typename Id> struct digraph {
+  Id vertex_count = 0;
+  std::vector<Id> offsets;
+  std::vector<Id> children;
+
+  /* The edges from[i] -> to[i]. The vertices must be less than vertex_count. */
+  template <typename T>
+  static digraph from_edges(std::span<const T> from, std::span<const T> to, Id vertex_count) {
+    digraph g;
+    g.vertex_count = vertex_count;
+    g.offsets.assign(static_cast<std::size_t>(vertex_count) + 1, 0);
+    g.children.resize(from.size());
+    for (T v : from) {
+      g.offsets[static_cast<Id>(v) + 1]++;
+    }
+    for (Id v = 0; v < vertex_count; v++) {
+      g.offsets[v + 1] += g.offsets[v];
+    }
+    std::vector<Id> positions(g.offsets.begin(), g.offsets.end() - 1);
+    for (std::size_t i = 0; i < from.size(); i++) {
+      g.children[positions[static_cast<Id>(from[i])]++] = static_cast<Id>(to[i]);
+    }
+    for (Id v = 0; v < vertex_count; v++) {
+      std::sort(g.children.begin() + g.offsets[v], g.children.begin() + g.offsets[v + 1]);
+    }
+    return g;
+  }
+};
+
+/* ==== Successor set policies ====
+
+   A policy builds one set at a time: begin starts a set for the component
+   with the given id, insert returns true if the id already was in the set,
+   unite adds a completed set, and finish returns the completed set. */
+
+template <typename Id> struct interval {
+  Id low;
+  Id high;
+};
+
+template <typename Id> class interval_sets {
+public:
+  using set = std::vector<interval<Id>>;
+
+  void begin(Id) { from_.clear(); }
+
+  bool insert(Id id) {
+    auto it = std::lower_bound(from_.begin(), from_.end(), id,
+			       [](const interval<Id> &i, Id x) { return i.high < x; });
+    if (it != from_.end() && it->low <= id) {
+      return true;
+    }
+    bool joins_next = (it != from_.end() && it->low == id + 1);
+    bool joins_previous = (it != from_.begin() && (it - 1)->high + 1 == id);
+    if (joins_previous && joins_next) {
+      (it - 1)->high = it->high;
+      from_.erase(it);
+    } else if (joins_previous) {
+      (it - 1)->high = id;
+    } else if (joins_next) {
+      it->low = id;
+    } else {
+      from_.insert(it, interval<Id>{id, id});
+    }
+    return false;
+  }
+
+  void unite(const set &other) {
+    if (other.empty()) {
+      return;
+    }
+    to_.clear();
+    auto a = from_.begin(), a_end = from_.end();
+    auto b = other.begin(), b_end = other.end();
+    while (a != a_end || b != b_end) {
+      const interval<Id> &next = (b == b_end || (a != a_end && a->low < b->low)) ? *a++ : *b++;
+      if (!to_.empty() && next.low <= to_.back().high + 1) {
+	to_.back().high = std::max(to_.back().high, next.high);
+      } else {
+	to_.push_back(next);
+      }
+    }
+    std::swap(from_, to_);
+  }
+
+  set finish() { return set(from_.begin(), from_.end()); }
+
+  static bool contains(const set &s, Id id) {
+    auto it = std::lower_bound(s.begin(), s.end(), id,
+			       [](const interval<Id> &i, Id x) { return i.high < x; });
+    return it != s.end() && it->low <= id;
+  }
+
+  template <typename F> static void for_each(const set &s, F &&f) {
+    for (const interval<Id> &i : s) {
+      for (Id id = i.low; id <= i.high; id++) {
+	f(id);
+      }
+    }
+  }
+
+private:
+  set from_, to_; /* The swap buffers, as in intervals.c */
+};
+
+template <typename Id> class bit_sets {
+public:
+  using set = std::vector<std::uint64_t>;
+
+  void begin(Id scc_id) { bits_.assign(static_cast<std::size_t>(scc_id) / 64 + 1, 0); }
+
+  bool insert(Id id) {
+    std::uint64_t mask = std::uint64_t(1) << (id % 64);
+    std::uint64_t &word = bits_[id / 64];
+    bool found = (word & mask) != 0;
+    word |= mask;
+    return found;
+  }
+
+  void unite(const set &other) {
+    for (std::size_t i = 0; i < other.size(); i++) {
+      bits_[i] |= other[i];
+    }
+  }
+
+  set finish() {
+    while (!bits_.empty() && bits_.back() == 0) {
+      bits_.pop_back();
+    }
+    return set(bits_.begin(), bits_.end());
+  }
+
+  static bool contains(const set &s, Id id) {
+    return id / 64 < s.size() && (s[id / 64] >> (id % 64)) & 1;
+  }
+
+  template <typename F> static void for_each(const set &s, F &&f) {
+    for (std::size_t i = 0; i < s.size(); i++) {
+      for (std::uint64_t word = s[i]; word != 0; word &= word - 1) {
+	f(static_cast<Id>(i * 64 + std::countr_zero(word)));
+      }
+    }
+  }
+
+private:
+  set bits_;
+};
+
+template <typename Id> class compressed_sets {
+public:
+  /* The ids in increasing order, each as the difference to the previous one
+     in 7-bit groups, the high bit telling that more groups follow */
+  using set = std::vector<std::uint8_t>;
+
+  void begin(Id) { from_.clear(); }
+
+  bool insert(Id id) {
+    auto it = std::lower_bound(from_.begin(), from_.end(), id);
+    if (it != from_.end() && *it == id) {
+      return true;
+    }
+    from_.insert(it, id);
+    return false;
+  }
+
+  void unite(const set &other) {
+    if (other.empty()) {
+      return;
+    }
+    to_.clear();
+    auto a = from_.begin(), a_end = from_.end();
+    for_each(other, [&](Id id) {
+      while (a != a_end && *a < id) {
+	to_.push_back(*a++);
+      }
+      if (a != a_end && *a == id) {
+	a++;
+      }
+      to_.push_back(id);
+    });
+    to_.insert(to_.end(), a, a_end);
+    std::swap(from_, to_);
+  }
+
+  set finish() {
+    set result;
+    Id previous = 0;
+    for (Id id : from_) {
+      Id delta = id - previous;
+      previous = id;
+      while (delta >= 0x80) {
+	result.push_back(static_cast<std::uint8_t>(delta | 0x80));
+	delta >>= 7;
+      }
+      result.push_back(static_cast<std::uint8_t>(delta));
+    }
+    result.shrink_to_fit();
+    return result;
+  }
+
+  static bool contains(const set &s, Id id) {
+    bool found = false;
+    for_each_until(s, [&](Id x) {
+      found = (x == id);
+      return x < id;
+    });
+    return found;
+  }
+
+  template <typename F> static void for_each(const set &s, F &&f) {
+    for_each_until(s, [&](Id id) {
+      f(id);
+      return true;
+    });
+  }
+
+private:
+  /* Decode the ids while f returns true */
+  template <typename F> static void for_each_until(const set &s, F &&f) {
+    Id id = 0;
+    std::size_t i = 0;
+    while (i < s.size()) {
+      Id delta = 0;
+      unsigned shift = 0;
+      std::uint8_t byte;
+      do {
+	byte = s[i++];
+	delta |= static_cast<Id>(byte & 0x7f) << shift;
+	shift += 7;
+      } while (byte & 0x80);
+      id += delta;
+      if (!f(id)) {
+	return;
+      }
+    }
+  }
+
+  std::vector<Id> from_, to_;
+};
+
+/* ==== The closure ==== */
+
+/* The interface of closures of any id type and set policy. The vertices and
+   components are given as 64-bit numbers. */
+class any_closure {
+public:
+  virtual ~any_closure() = default;
+  virtual std::int64_t vertex_count() const = 0;
+  virtual std::int64_t component_count() const = 0;
+  virtual std::int64_t component(std::int64_t vertex) const = 0;
+  /* 1 if there is a non-empty path from the vertex from to the vertex to */
+  virtual bool reachable(std::int64_t from, std::int64_t to) const = 0;
+  virtual std::vector<std::int64_t> successors(std::int64_t vertex) const = 0;
+  /* The id width and the set policy, for example "u32/intervals" */
+  virtual const char *variant() const = 0;
+};
+
+template <typename Id> struct id_name;
+template <> struct id_name<std::uint32_t> { static constexpr const char *value = "u32"; };
+template <> struct id_name<std::uint64_t> { static constexpr const char *value = "u64"; };
+
+template <typename Sets> struct sets_name;
+template <typename Id> struct sets_name<interval_sets<Id>> { static constexpr const char *value = "intervals"; };
+template <typename Id> struct sets_name<bit_sets<Id>> { static constexpr const char *value = "bitset"; };
+template <typename Id> struct sets_name<compressed_sets<Id>> { static constexpr const char *value = "compressed"; };
+
+template <typename Id, typename Sets> class closure : public any_closure {
+public:
+  static constexpr Id none = std::numeric_limits<Id>::max();
+
+  /* The algorithm of algorithm.c with an explicit stack instead of recursion */
+  explicit closure(const digraph<Id> &g)
+    : vertex_count_(g.vertex_count), scc_of_(g.vertex_count, none), vertex_table_(g.vertex_count),
+      scc_offsets_(1, 0) {
+    Id n = g.vertex_count;
+    std::vector<Id> dfn(n, none);
+    std::vector<Id> vertex_stack;
+    std::vector<Id> scc_stack;
+    std::vector<Id> stamps(n, none);
+    std::vector<frame> frames;
+    Sets sets;
+    Id dfn_counter = 0;
+    Id vertex_count = 0;
+    for (Id root = 0; root < n; root++) {
+      if (dfn[root] != none) {
+	continue;
+      }
+      frames.push_back(frame{root, g.offsets[root], dfn_counter, static_cast<Id>(scc_stack.size()), false});
+      dfn[root] = dfn_counter++;
+      vertex_stack.push_back(root);
+      while (!frames.empty()) {
+	frame &f = frames.back();
+	if (f.edge != g.offsets[f.vertex + 1]) {
+	  Id child = g.children[f.edge++];
+	  if (dfn[child] == none) {
+	    /* Tree edge */
+	    frames.push_back(frame{child, g.offsets[child], dfn_counter, static_cast<Id>(scc_stack.size()), false});
+	    dfn[child] = dfn_counter++;
+	    vertex_stack.push_back(child);
+	  } else if (dfn[child] > dfn[f.vertex]) {
+	    /* Forward edge */
+	  } else if (scc_of_[child] != none) {
+	    /* Intercomponent cross edge */
+	    scc_stack.push_back(scc_of_[child]);
+	  } else if (dfn[child] < f.lowest) {
+	    f.lowest = dfn[child];
+	  } else if (child == f.vertex) {
+	    f.self_loop = true;
+	  }
+	  continue;
+	}
+	frame done = f;
+	frames.pop_back();
+	if (done.lowest != dfn[done.vertex]) {
+	  if (done.lowest < frames.back().lowest) {
+	    frames.back().lowest = done.lowest;
+	  }
+	  continue;
+	}
+	/* done.vertex is the root of a new component */
+	Id scc_id = static_cast<Id>(successors_.size());
+	bool self_insert = done.self_loop || vertex_stack.back() != done.vertex;
+	sets.begin(scc_id);
+	auto first = scc_stack.begin() + done.scc_stack_position;
+	auto last = std::remove_if(first, scc_stack.end(), [&](Id c) {
+	  if (stamps[c] == scc_id) {
+	    return true;
+	  }
+	  stamps[c] = scc_id;
+	  return false;
+	});
+	std::sort(first, last, std::greater<Id>());
+	for (auto c = first; c != last; ++c) {
+	  if (!sets.insert(*c)) {
+	    sets.unite(successors_[*c]);
+	  }
+	}
+	scc_stack.resize(done.scc_stack_position);
+	if (self_insert) {
+	  sets.insert(scc_id);
+	}
+	successors_.push_back(sets.finish());
+	Id popped;
+	do {
+	  popped = vertex_stack.back();
+	  vertex_stack.pop_back();
+	  scc_of_[popped] = scc_id;
+	  vertex_table_[vertex_count++] = popped;
+	} while (popped != done.vertex);
+	scc_offsets_.push_back(vertex_count);
+	if (!frames.empty()) {
+	  scc_stack.push_back(scc_id);
+	}
+      }
+    }
+  }
+
+  std::int64_t vertex_count() const override { return static_cast<std::int64_t>(vertex_count_); }
+  std::int64_t component_count() const override { return static_cast<std::int64_t>(successors_.size()); }
+
+  std::int64_t component(std::int64_t vertex) const override {
+    if (vertex < 0 || vertex >= vertex_count()) {
+      return -1;
+    }
+    return static_cast<std::int64_t>(scc_of_[vertex]);
+  }
+
+  bool reachable(std::int64_t from, std::int64_t to) const override {
+    if (component(from) < 0 || component(to) < 0) {
+      return false;
+    }
+    return Sets::contains(successors_[scc_of_[from]], scc_of_[to]);
+  }
+
+  std::vector<std::int64_t> successors(std::int64_t vertex) const override {
+    std::vector<std::int64_t> result;
+    if (component(vertex) >= 0) {
+      for_each_successor(static_cast<Id>(vertex), [&](Id w) { result.push_back(static_cast<std::int64_t>(w)); });
+    }
+    return result;
+  }
+
+  const char *variant() const override {
+    static const std::string name = std::string(id_name<Id>::value) + "/" + sets_name<Sets>::value;
+    return name.c_str();
+  }
+
+  /* The typed interface */
+
+  Id scc_of(Id vertex) const { return scc_of_[vertex]; }
+
+  std::span<const Id> vertices(Id scc_id) const {
+    return {vertex_table_.data() + scc_offsets_[scc_id], vertex_table_.data() + scc_offsets_[scc_id + 1]};
+  }
+
+  const typename Sets::set &successor_set(Id scc_id) const { return successors_[scc_id]; }
+
+  template <typename F> void for_each_successor_component(Id scc_id, F &&f) const {
+    Sets::for_each(successors_[scc_id], f);
+  }
+
+  template <typename F> void for_each_successor(Id vertex, F &&f) const {
+    Sets::for_each(successors_[scc_of_[vertex]], [&](Id c) {
+      for (Id w : vertices(c)) {
+	f(w);
+      }
+    });
+  }
+
+private:
+  struct frame {
+    Id vertex;
+    Id edge;
+    Id lowest;
+    Id scc_stack_position;
+    bool self_loop;
+  };
+
+  Id vertex_count_;
+  std::vector<Id> scc_of_;
+  std::vector<Id> vertex_table_; /* The vertices of the components, in the order of the components */
+  std::vector<Id> scc_offsets_;
+  std::vector<typename Sets::set> successors_;
+};
+
+/* ==== The dispatcher ==== */
+
+enum class set_policy { automatic, intervals, bitset, compressed };
+
+/* The largest number of vertices for which set_policy::automatic chooses
+   bit sets; the sets take at most n*n/16 bytes. */
+constexpr std::int64_t bitset_max_vertices = 8192;
+
+namespace detail {
+
+template <typename Id, typename T>
+std::unique_ptr<any_closure> compute_with(std::span<const T> from, std::span<const T> to, std::int64_t vertex_count,
+					  set_policy policy) {
+  digraph<Id> g = digraph<Id>::from_edges(from, to, static_cast<Id>(vertex_count));
+  switch (policy) {
+  case set_policy::bitset:
+    return std::make_unique<closure<Id, bit_sets<Id>>>(g);
+  case set_policy::compressed:
+    return std::make_unique<closure<Id, compressed_sets<Id>>>(g);
+  default:
+    return std::make_unique<closure<Id, interval_sets<Id>>>(g);
+  }
+}
+
+}
+
+/* Compute the closure of the edges from[i] -> to[i]. If vertex_count is
+   negative, it is the largest vertex plus one. 32-bit ids are used when
+   the vertices and the edges fit. */
+template <typename T>
+std::unique_ptr<any_closure> compute(std::span<const T> from, std::span<const T> to, std::int64_t vertex_count = -1,
+				     set_policy policy = set_policy::automatic) {
+  if (from.size() != to.size()) {
+    throw std::invalid_argument("stacktc::engine::compute: from and to differ in length");
+  }
+  std::int64_t max_vertex = -1;
+  for (std::size_t i = 0; i < from.size(); i++) {
+    if (from[i] < 0 || to[i] < 0) {
+      throw std::out_of_range("stacktc::engine::compute: negative vertex");
+    }
+    max_vertex = std::max<std::int64_t>(max_vertex, std::max<std::int64_t>(from[i], to[i]));
+  }
+  if (vertex_count < 0) {
+    vertex_count = max_vertex + 1;
+  } else if (max_vertex >= vertex_count) {
+    throw std::out_of_range("stacktc::engine::compute: vertex out of range");
+  }
+  if (policy == set_policy::automatic) {
+    policy = (vertex_count <= bitset_max_vertices ? set_policy::bitset : set_policy::intervals);
+  }
+  /* The largest id value is reserved for none */
+  constexpr std::uint64_t u32_limit = std::numeric_limits<std::uint32_t>::max();
+  if (static_cast<std::uint64_t>(vertex_count) < u32_limit && from.size() < u32_limit) {
+    return detail::compute_with<std::uint32_t>(from, to, vertex_count, policy);
+  }
+  return detail::compute_with<std::uint64_t>(from, to, vertex_count, policy);
+}
+
+}
+
+#endif
@@ -16,21 +16,87 @@
 TC *TC_new(Digraph *g)
 {
   TC *this = NEW(TC);
-  vint vertex_count = this->vertex_count = g->vertex_count;
+  vint vertex_count = this->vertex_id_count = g->vertex_count;
   this->vertex_id_to_scc_id_table = new_vint_table(vertex_count, -1);
-  this->scc_table = NEWN(SCC*,vertex_count);
   this->scc_count = 0;
-  this->vertex_table = new_vint_table(vertex_count, -1);
-  this->vertex_count = this->saved_vertex_count = 0;
+  this->root_table = NEWN(vint, vertex_count);
+  this->vertex_offset_table = NEWN(vint, (vertex_count + 1));
+  this->vertex_offset_table[0] = 0;
+  this->successor_table = NEWN(Interval*, vertex_count);
+  this->successor_count_table = NEWN(vint, vertex_count);
+  this->successor_low_table = NEWN(vint, vertex_count);
+  this->successor_high_table = NEWN(vint, vertex_count);
+  this->level_table = NEWN(vint, vertex_count);
+  this->interval_store = IntervalStore_new();
+  this->vertex_table = NEWN(vint, vertex_count);
+  this->vertex_count = 0;
+  this->reversep = g->reversep;
+  this->labels = g->labels;
+  this->id_map = g->id_map;
+  this->adjacent_table = NULL;
+  this->adjacent_offset_table = NULL;
+  this->adjacent_count = 0;
+  this->search_table = NULL;
+  this->search_sets = NULL;
+  this->search_set_count = 0;
   Intervals_initialize_tc(vertex_count);
   return this;
 }
 
-SCC *TC_create_scc(TC *this, vint root_id) {
+/* Free the closure. The labels and the id map belong to the digraph. */
+void TC_delete(TC *this) {
+  DELETE(this->root_table);
+  DELETE(this->vertex_offset_table);
+  DELETE(this->successor_table);
+  DELETE(this->successor_count_table);
+  DELETE(this->successor_low_table);
+  DELETE(this->successor_high_table);
+  DELETE(this->level_table);
+  IntervalStore_delete(this->interval_store);
+  DELETE(this->vertex_table);
+  DELETE(this->vertex_id_to_scc_id_table);
+  TC_delete_adjacent(this);
+  for (vint i = 0; i < this->search_set_count; i++) {
+    IntervalSearch_free(&(this->search_sets[i]));
+  }
+  DELETE(this->search_sets);
+  DELETE(this->search_table);
+  DELETE(this);
+}
+
+/* Record the adjacent components of the components. There is at most one
+   adjacent component for each edge of the digraph. */
+void TC_initialize_adjacent(TC *this, vint max_count) {
+  this->adjacent_table = NEWN(vint, max_count);
+  this->adjacent_offset_table = NEWN(vint, (this->vertex_id_count + 1));
+  this->adjacent_offset_table[0] = 0;
+  this->adjacent_count = 0;
+}
+
+/* Free the adjacent components when they are no longer needed */
+void TC_delete_adjacent(TC *this) {
+  DELETE(this->adjacent_table);
+  DELETE(this->adjacent_offset_table);
+  this->adjacent_table = this->adjacent_offset_table = NULL;
+  this->adjacent_count = 0;
+}
+
+/* Returns the id of the new component */
+vint TC_create_scc(TC *this, vint root_id) {
   DBG("create_scc, root=" VFMT "\n", root_id);
-  SCC *result = this->scc_table[this->scc_count] = SCC_new(this->scc_count, root_id, this->vertex_table+this->vertex_count);
-  this->scc_count++;
-  return result;
+  vint scc_id = this->scc_count++;
+  this->root_table[scc_id] = root_id;
+  this->successor_table[scc_id] = NULL;
+  this->successor_count_table[scc_id] = 0;
+  this->successor_low_table[scc_id] = 0;
+  this->successor_high_table[scc_id] = -1;
+  this->level_table[scc_id] = 0;
+  return scc_id;
+}
+
+/* Add an adjacent component to the last created component */
+void TC_insert_adjacent(TC *this, vint scc_id) {
+  this->adjacent_table[this->adjacent_count++] = scc_id;
 }
 
 void TC_insert_vertex(TC *this, vint vertex_id) {
@@ -38,37 +104,212 @@ void TC_insert_vertex(TC *this, vint vertex_id) {
     this->vertex_id_to_scc_id_table[vertex_id] = this->scc_count-1;
 }
 
+/* The vertices and the adjacent components of the last created component
+   end here */
 void TC_scc_completed(TC *this) {
-  this->scc_table[this->scc_count-1]->vertex_count = this->vertex_count - this->saved_vertex_count;
-  this->saved_vertex_count = this->vertex_count;
+  this->vertex_offset_table[this->scc_count] = this->vertex_count;
+  if (this->adjacent_offset_table != NULL) {
+    this->adjacent_offset_table[this->scc_count] = this->adjacent_count;
+  }
+}
+
+/* Complete the open successor set of a component and free it. An empty set
+   is not stored. */
+void TC_set_successors(TC *this, vint scc_id, Intervals *succ) {
+  if (succ->interval_count == 0) {
+    DELETE(succ);
+    return;
+  }
+  this->successor_count_table[scc_id] = succ->interval_count;
+  this->successor_low_table[scc_id] = succ->interval_table[0].low;
+  this->successor_high_table[scc_id] = succ->interval_table[succ->interval_count - 1].high;
+  this->successor_table[scc_id] = Intervals_completed(succ, this->interval_store);
+}
+
+vint TC_scc_root(TC *this, vint scc_id) {
+  return this->root_table[scc_id];
+}
+
+vint *TC_scc_vertices(TC *this, vint scc_id) {
+  return this->vertex_table + this->vertex_offset_table[scc_id];
+}
+
+vint TC_scc_vertex_count(TC *this, vint scc_id) {
+  return this->vertex_offset_table[scc_id + 1] - this->vertex_offset_table[scc_id];
+}
+
+/* The adjacent components are recorded only in some modes, see tc.h */
+vint *TC_scc_adjacent(TC *this, vint scc_id) {
+  return this->adjacent_table + this->adjacent_offset_table[scc_id];
+}
+
+vint TC_scc_adjacent_count(TC *this, vint scc_id) {
+  if (this->adjacent_offset_table == NULL) {
+    return 0;
+  }
+  return this->adjacent_offset_table[scc_id + 1] - this->adjacent_offset_table[scc_id];
 }
 
-SCC *TC_scc_id_to_scc(TC *this, vint scc_id) {
-  return this->scc_table[scc_id];
+/* The component gathered from the tables */
+SCC TC_scc_id_to_scc(TC *this, vint scc_id) {
+  SCC scc;
+  scc.scc_id = scc_id;
+  scc.root_vertex_id = this->root_table[scc_id];
+  scc.vertex_table = TC_scc_vertices(this, scc_id);
+  scc.vertex_count = TC_scc_vertex_count(this, scc_id);
+  scc.successors = TC_scc_id_to_successor_set(this, scc_id);
+  scc.adjacent_count = TC_scc_adjacent_count(this, scc_id);
+  scc.adjacent_table = (scc.adjacent_count > 0 ? TC_scc_adjacent(this, scc_id) : NULL);
+  return scc;
 }
 
-Intervals *TC_scc_id_to_successor_set(TC *this, vint scc_id) {
-  return this->scc_table[scc_id]->successors;
+/* The set refers to the tables of the closure; it must not be changed */
+Intervals TC_scc_id_to_successor_set(TC *this, vint scc_id) {
+  Intervals successors;
+  successors.interval_table = this->successor_table[scc_id];
+  successors.interval_count = this->successor_count_table[scc_id];
+  return successors;
 }
 
 vint TC_vertex_id_to_scc_id(TC *this, vint vertex_id) {
   return this->vertex_id_to_scc_id_table[vertex_id];
 }
 
-SCC *TC_vertex_id_to_scc(TC *this, vint vertex_id) {
-  return this->scc_table[this->vertex_id_to_scc_id_table[vertex_id]];
+SCC TC_vertex_id_to_scc(TC *this, vint vertex_id) {
+  return TC_scc_id_to_scc(this, this->vertex_id_to_scc_id_table[vertex_id]);
 }
 
-Intervals *TC_vertex_id_to_successor_set(TC *this, vint vertex_id) {
-  return this->scc_table[this->vertex_id_to_scc_id_table[vertex_id]]->successors;
+Intervals TC_vertex_id_to_successor_set(TC *this, vint vertex_id) {
+  return TC_scc_id_to_successor_set(this, this->vertex_id_to_scc_id_table[vertex_id]);
 }
 
+typedef struct search_owner_struct {
+  Interval *interval_table;
+  vint scc_id;
+} SearchOwner;
+
+static int cmp_search_owner(const void *a, const void *b) {
+  Interval *x = ((SearchOwner*)a)->interval_table;
+  Interval *y = ((SearchOwner*)b)->interval_table;
+  return (x < y ? -1 : x > y ? 1 : 0);
+}
+
+/* Lay out the large successor sets for point lookups, so that
+   TC_sccs_edge_exists is faster when the closure is queried many times.
+   The components sharing a table share the layout, which is built only
+   once. */
+void TC_build_search(TC *this) {
+  if (this->search_table != NULL) {
+    return;
+  }
+  SearchOwner *owners = NEWN(SearchOwner, this->scc_count);
+  vint owner_count = 0;
+  for (vint scc_id = 0; scc_id < this->scc_count; scc_id++) {
+    if (this->successor_count_table[scc_id] >= INTERVALS_SEARCH_MIN_COUNT) {
+      owners[owner_count].interval_table = this->successor_table[scc_id];
+      owners[owner_count].scc_id = scc_id;
+      owner_count++;
+    }
+  }
+  qsort(owners, owner_count, sizeof(SearchOwner), &cmp_search_owner);
+  this->search_table = NEWN(IntervalSearch*, this->scc_count);
+  memset(this->search_table, 0, sizeof(IntervalSearch*)*this->scc_count);
+  this->search_sets = NEWN(IntervalSearch, owner_count);
+  this->search_set_count = 0;
+  for (vint i = 0; i < owner_count; i++) {
+    if (i == 0 || owners[i].interval_table != owners[i-1].interval_table) {
+      vint scc_id = owners[i].scc_id;
+      IntervalSearch_build(&(this->search_sets[this->search_set_count++]),
+			   this->successor_table[scc_id], this->successor_count_table[scc_id]);
+    }
+    this->search_table[owners[i].scc_id] = &(this->search_sets[this->search_set_count - 1]);
+  }
+  DELETE(owners);
+}
+
+/* A component without successors has an empty successor set. Most
+   negative answers are decided without searching the set: a component
+   reaches only components with smaller or equal ids in the range of its
+   set, and other components only at a lower level. */
 vint TC_sccs_edge_exists(TC *this, vint scc_from_id, vint scc_to_id) {
-  return Intervals_find(TC_scc_id_to_successor_set(this, scc_from_id), scc_to_id);
+  if (scc_to_id < this->successor_low_table[scc_from_id]
+      || scc_to_id > this->successor_high_table[scc_from_id]
+      || (scc_to_id != scc_from_id && this->level_table[scc_to_id] >= this->level_table[scc_from_id])) {
+    return 0;
+  }
+  if (this->search_table != NULL && this->search_table[scc_from_id] != NULL) {
+    return IntervalSearch_find(this->search_table[scc_from_id], scc_to_id);
+  }
+  Intervals successors;
+  successors.interval_table = this->successor_table[scc_from_id];
+  successors.interval_count = this->successor_count_table[scc_from_id];
+  return Intervals_find(&successors, scc_to_id);
 }
 
 vint TC_vertices_edge_exists(TC *this, vint vertex_from_id, vint vertex_to_id) {
-  return Intervals_find(TC_vertex_id_to_successor_set(this, vertex_from_id),
-			   TC_vertex_id_to_scc_id(this, vertex_to_id));
+  vint scc_from_id = TC_vertex_id_to_scc_id(this, vertex_from_id);
+  vint scc_to_id = TC_vertex_id_to_scc_id(this, vertex_to_id);
+  Assert(scc_from_id >= 0);
+  if (scc_to_id < 0) {
+    /* Not reachable from the sources, thus not reachable from vertex_from_id */
+    return 0;
+  }
+  return TC_sccs_edge_exists(this, scc_from_id, scc_to_id);
 }
 
+/* The targets reachable from any of the sources, or not reachable from any
+   of them if negatep is set. The successor sets of the source components are
+   unioned at the same time and the union is intersected with the set of the
+   target components. The result is stored in the
+   result table in the order of the targets and the number of results is
+   returned. The sources not in the closure are ignored. */
+vint TC_reachable_targets(TC *this, vint *sources, vint source_count,
+			  vint *targets, vint target_count, int negatep, vint *result) {
+  /* Only the swap buffers are needed for the union, which has component ids */
+  Intervals_reserve(this->scc_count);
+  Intervals *successor_sets = NEWN(Intervals, source_count);
+  vint set_count = 0;
+  vint *scc_ids = NEWN(vint, (source_count > target_count ? source_count : target_count));
+  vint *buffer = NEWN(vint, (source_count > target_count ? source_count : target_count));
+  vint id_count = 0;
+  for (vint i = 0; i < source_count; i++) {
+    vint scc_id = TC_vertex_id_to_scc_id(this, sources[i]);
+    if (scc_id >= 0) {
+      scc_ids[id_count++] = scc_id;
+    }
+  }
+  /* Each source component is unioned only once */
+  sort_vints(scc_ids, id_count, this->scc_count, buffer);
+  for (vint i = 0; i < id_count; i++) {
+    if (i == 0 || scc_ids[i] != scc_ids[i-1]) {
+      successor_sets[set_count++] = TC_scc_id_to_successor_set(this, scc_ids[i]);
+    }
+  }
+  Intervals *reachable = Intervals_new();
+  Intervals_union_all(reachable, successor_sets, set_count);
+  id_count = 0;
+  for (vint i = 0; i < target_count; i++) {
+    vint scc_id = TC_vertex_id_to_scc_id(this, targets[i]);
+    if (scc_id >= 0) {
+      scc_ids[id_count++] = scc_id;
+    }
+  }
+  sort_vints(scc_ids, id_count, this->scc_count, buffer);
+  Intervals *target_set = Intervals_from_sorted(scc_ids, id_count);
+  Intervals_intersection(reachable, target_set);
+  vint count = 0;
+  for (vint i = 0; i < target_count; i++) {
+    vint scc_id = TC_vertex_id_to_scc_id(this, targets[i]);
+    vint reachablep = (scc_id >= 0 && Intervals_find(reachable, scc_id));
+    if (negatep ? !reachablep : reachablep) {
+      result[count++] = targets[i];
+    }
+  }
+  /* The open set is in the buffers of intervals.c and is not completed */
+  DELETE(reachable);
+  Intervals_delete(target_set);
+  DELETE(successor_sets);
+  DELETE(scc_ids);
+  DELETE(buffer);
+  return count;
+}
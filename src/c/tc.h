@@ -8,6 +8,37 @@
   File: tc.h
 
   The transitive closure result representation.
+
+  If the closure was computed from a reversed digraph (see digraph_reverse),
+  reversep is set and the successor sets are the predecessor sets of the
+  original digraph. The query functions work in the same way; for example
+  TC_vertices_edge_exists(tc, v, w) then tells whether w is an ancestor of v.
+
+  If the closure was computed only from some source vertices (see
+  stacktc_sources), the vertices not reachable from the sources are not in
+  the closure and TC_vertex_id_to_scc_id returns -1 for them. The other
+  functions taking a vertex id must not be called with such vertices, except
+  as the target vertex of TC_vertices_edge_exists.
+
+  With the mode tc_reduction, each component also has the table of its
+  adjacent components in the transitive reduction of the condensation graph.
+  With the mode tc_condensation, the table has all adjacent components and
+  there are no successor sets, so the closure cannot be queried.
+
+  The components are not separate structures but rows of parallel tables in
+  the TC (see types.h), so that a query touches only the tables it needs.
+  TC_scc_id_to_scc gathers a component from the tables when all its parts
+  are needed. The successor sets are returned as interval sets referring to
+  the tables of the closure; identical sets have the same table.
+
+  Each component also has the range of its successors and its level, the
+  length of the longest path from it to a component without successors in
+  the condensation graph, so that most negative queries are answered without
+  searching the successor set.
+
+  For many point queries, TC_build_search copies the large successor sets to
+  a layout that is faster to search (see intervals.c). The sets are then
+  stored twice.
   =============================================================================
 */
 
@@ -21,15 +52,28 @@
 #include "scc.h"
 
 TC *TC_new(Digraph *g);
-SCC *TC_create_scc(TC *this, vint root_id);
+void TC_delete(TC *this);
+void TC_initialize_adjacent(TC *this, vint max_count);
+void TC_delete_adjacent(TC *this);
+vint TC_create_scc(TC *this, vint root_id);
+void TC_insert_adjacent(TC *this, vint scc_id);
 void TC_insert_vertex(TC *this, vint vertex_id);
 void TC_scc_completed(TC *this);
-SCC *TC_scc_id_to_scc(TC *this, vint scc_id);
-Intervals *TC_scc_id_to_successor_set(TC *this, vint scc_id);
+void TC_set_successors(TC *this, vint scc_id, Intervals *succ);
+vint TC_scc_root(TC *this, vint scc_id);
+vint *TC_scc_vertices(TC *this, vint scc_id);
+vint TC_scc_vertex_count(TC *this, vint scc_id);
+vint *TC_scc_adjacent(TC *this, vint scc_id);
+vint TC_scc_adjacent_count(TC *this, vint scc_id);
+SCC TC_scc_id_to_scc(TC *this, vint scc_id);
+Intervals TC_scc_id_to_successor_set(TC *this, vint scc_id);
 vint TC_vertex_id_to_scc_id(TC *this, vint vertex_id);
-SCC *TC_vertex_id_to_scc(TC *this, vint vertex_id);
-Intervals *TC_vertex_id_to_successor_set(TC *this, vint vertex_id);
+SCC TC_vertex_id_to_scc(TC *this, vint vertex_id);
+Intervals TC_vertex_id_to_successor_set(TC *this, vint vertex_id);
+void TC_build_search(TC *this);
 vint TC_sccs_edge_exists(TC *this, vint scc_from_id, vint scc_to_id);
 vint TC_vertices_edge_exists(TC *this, vint vertex_from_id, vint vertex_to_id);
+vint TC_reachable_targets(TC *this, vint *sources, vint source_count,
+			  vint *targets, vint target_count, int negatep, vint *result);
 
 #endif
@@ -36,19 +36,69 @@ typedef struct intervals_struct {
   vint interval_count;
 } Intervals;
 
+/* A completed interval set laid out for point lookups, see intervals.c */
+typedef struct interval_search_struct {
+  vint *low_table; /* The lows in Eytzinger order from index 1 */
+  vint *high_table; /* The highs in the same order */
+  vint interval_count;
+} IntervalSearch;
+
+/* The file where the chunks of interval stores are spilled, see intervals.c */
+typedef struct interval_log_struct {
+  int fd;
+  size_t file_size;
+  size_t memory_budget; /* Bytes of chunks kept in memory */
+  size_t memory_used;
+} IntervalLog;
+
+/* The completed interval tables of a closure, see intervals.c */
+typedef struct interval_store_struct {
+  Interval **chunk_table;
+  vint *chunk_size_table; /* In intervals */
+  int *chunk_mapped_table; /* The chunk is mapped from the log file */
+  vint chunk_count;
+  vint chunk_used; /* Intervals used in the last chunk */
+} IntervalStore;
+
+/* A strong component of a closure, see TC_scc_id_to_scc */
 typedef struct scc_struct {
   vint scc_id;
   vint root_vertex_id;
   vint *vertex_table;
   vint vertex_count;
-  Intervals* successors;
+  Intervals successors; /* Empty if the component has no successors */
+  vint *adjacent_table; /* The adjacent components if recorded, see enum tc_mode */
+  vint adjacent_count;
 } SCC;
 
+typedef struct labels_struct {
+  char *arena_block; /* The blocks are chained through their first word */
+  char *arena_free;
+  char *arena_limit;
+  vint *hash_table; /* Label ids, -1 for an empty slot */
+  vint hash_size; /* Always a power of two */
+  char **label_table;
+  unsigned long *hash_values;
+  vint label_count;
+  vint label_size;
+} Labels;
+
+typedef struct idmap_struct {
+  vint *hash_table; /* Dense ids, -1 for an empty slot */
+  vint hash_size; /* Always a power of two */
+  vint *original_ids; /* Maps the dense ids back to the ids in the input */
+  vint id_count;
+  vint id_size;
+} IdMap;
+
 typedef struct digraph_struct {
   Vertex *vertex_table;
   vint vertex_count;
   vint *edge_table;
   vint edge_count;
+  int reversep; /* The edges have been reversed, see digraph_reverse */
+  Labels *labels; /* The vertex labels or NULL if the vertices are numbers */
+  IdMap *id_map; /* The ids in the input or NULL if they are the vertex ids */
 } Digraph;
 
 typedef struct edge_struct {
@@ -56,37 +106,130 @@ typedef struct edge_struct {
   vint to;
 } EDGE;
 
+typedef struct edge_buffer_struct {
+  EDGE *edges;
+  vint edge_count;
+  vint edge_size;
+  vint max_vertex;
+  vint line_count; /* The number of lines parsed to this buffer */
+  vint error_line; /* The first illegal line counted from the start of this buffer, 0 for a missing header, or -1 */
+  char *error_text; /* A copy of the illegal line */
+  vint spill_limit; /* The edges are spilled when there are this many, or 0, see reader.c */
+  IdMap *id_map; /* Sparse numbers are interned before spilling, or NULL */
+  int run_fd; /* The file of the sorted runs spilled from the buffer, or -1 */
+  size_t run_file_size;
+  vint *run_length_table; /* In edges */
+  vint run_count;
+} EdgeBuffer;
+
+/* The components are stored in parallel tables indexed by the component id.
+   The vertices of the component i are from vertex_offset_table[i] to
+   vertex_offset_table[i+1]-1 in vertex_table, and its adjacent components
+   are in adjacent_table in the same way. */
 typedef struct tc_struct {
-  SCC **scc_table;
   vint scc_count;
+  vint *root_table; /* The root vertex of each component */
+  vint *vertex_offset_table;
+  Interval **successor_table; /* The successor intervals of each component, NULL if none */
+  vint *successor_count_table; /* The number of successor intervals of each component */
+  vint *successor_low_table; /* The smallest successor of each component */
+  vint *successor_high_table; /* The largest successor of each component, less than the low if none */
+  vint *level_table; /* The longest path from each component to a component without successors */
+  IntervalStore *interval_store; /* Where the successor intervals are */
   vint *vertex_table; /* All vertices of all components are in the same table */
   vint vertex_count; /* Shows the position where new vertex is put */
   vint *vertex_id_to_scc_id_table;
-  vint saved_vertex_count; /* Used for counting the number of vertices in a component */
+  vint vertex_id_count; /* The number of vertices in the digraph; may be larger than vertex_count */
+  int reversep; /* The successor sets are predecessor sets of the original digraph */
+  Labels *labels; /* The vertex labels or NULL if the vertices are numbers */
+  IdMap *id_map; /* The ids in the input or NULL if they are the vertex ids */
+  vint *adjacent_table; /* The adjacent components of all components or NULL if not recorded */
+  vint *adjacent_offset_table; /* NULL if the adjacent components are not recorded */
+  vint adjacent_count; /* Shows the position where new adjacent component is put */
+  IntervalSearch **search_table; /* The lookup layout of each component or NULL, see TC_build_search */
+  IntervalSearch *search_sets; /* The distinct lookup layouts */
+  vint search_set_count;
 } TC;
 
+/* The estimated sizes of a closure, see estimate.c */
+typedef struct closure_estimate_struct {
+  int sketch_size;
+  double relative_error; /* Of the inexact sizes, at about 95% confidence */
+  double *successor_count_table; /* The estimated number of successor vertices of each component */
+  int *exact_table; /* The number of successors of the component is exact */
+  double edge_count; /* The edges of the closure */
+  double edge_count_low;
+  double edge_count_high;
+  double edges_bytes; /* The size of the output of --edges */
+  double vertices_bytes; /* The size of the output of --vertices */
+  double memory_bytes_low; /* The memory needed by stacktc without the successor sets */
+  double memory_bytes_high; /* An upper bound of the memory needed by stacktc */
+} ClosureEstimate;
+
 typedef struct tc_scc_iter_struct {
   int reversep;
   TC *tc;
-  Intervals *intervals;
+  Interval *interval_table;
   vint current_interval_index;
   vint interval_limit;
   vint to_scc_id;
   vint to_scc_limit;
 } TCSCCIter;
 
+typedef struct tc_vertex_iter_struct {
+  int reversep;
+  TCSCCIter scc_iter;
+  vint *to_vertex_table; /* The vertices of the current successor component */
+  vint to_vertex_count;
+  vint to_vertex_index;
+} TCVertexIter;
+
+/* An iterator of the library interface, see stacktc.h */
+typedef struct tc_iter_struct {
+  int vertexp; /* Iterating over vertices instead of components */
+  TCSCCIter scc_iter;
+  TCVertexIter vertex_iter;
+} TCIter;
+
 typedef struct matrix_struct {
   vint n;
   vint *elements;
 } Matrix;
 
+enum input_format {
+  input_numbers = 1,
+  input_labels = 2,
+  input_sparse_numbers = 3
+};
+
+enum tc_mode {
+  tc_closure = 1, /* Compute the successor sets */
+  tc_reduction = 2, /* Also record the adjacent components in the transitive reduction */
+  tc_condensation = 3 /* Record all adjacent components instead of computing the successor sets */
+};
+
+enum tc_algorithm {
+  algorithm_stacktc = 1,
+  algorithm_bfs = 2,
+  algorithm_topological = 3,
+  algorithm_warshall = 4
+};
+
+enum relabel_order {
+  relabel_dfs = 1, /* Depth-first preorder */
+  relabel_bfs = 2 /* Breadth-first order, children by increasing outdegree */
+};
+
 enum output_format {
   output_vertices = 1,
   output_edges = 2,
   output_components = 3,
   output_component_edges = 4,
   output_intervals = 5,
-  output_nothing = 6
+  output_nothing = 6,
+  output_reduction = 7,
+  output_condensation = 8,
+  output_estimate = 9
 };
 
 #endif
@@ -23,7 +23,70 @@ vint *new_vint_table(vint nelem, vint init) {
   return table;
 }
 
-/* Compare two vints. Used as a parameter for qsort */
+/* Compare two vints. Used as a parameter for qsort. The difference of two
+   vints does not fit to an int, thus the result is computed by comparisons. */
 int cmp_vint(const void *a, const void *b) {
-  return (*((vint*)a) - *((vint*)b));
+  vint x = *((vint*)a);
+  vint y = *((vint*)b);
+  return (x > y) - (x < y);
+}
+
+/* Sort a table of vints that are all in the range 0..limit-1 into increasing
+   order. Short tables are sorted by insertion sort, longer ones by a least
+   significant digit radix sort that needs a buffer of the same size and only
+   as many passes as there are digits in limit-1. Both take linear time in the
+   number of the vints for a fixed limit. */
+void sort_vints(vint *table, vint count, vint limit, vint *buffer) {
+  if (count <= SORT_VINTS_SMALL) {
+    for (vint i = 1; i < count; i++) {
+      vint x = table[i];
+      vint j = i;
+      while (j > 0 && table[j - 1] > x) {
+	table[j] = table[j - 1];
+	j--;
+      }
+      table[j] = x;
+    }
+  } else {
+    vint counts[SORT_VINTS_RADIX];
+    vint *from = table, *to = buffer, *tmp;
+    for (int shift = 0; shift == 0 || (limit - 1) >> shift; shift += SORT_VINTS_RADIX_BITS) {
+      memset(counts, 0, sizeof(counts));
+      for (vint i = 0; i < count; i++) {
+	counts[(from[i] >> shift) & (SORT_VINTS_RADIX - 1)]++;
+      }
+      vint position = 0;
+      for (int d = 0; d < SORT_VINTS_RADIX; d++) {
+	vint c = counts[d];
+	counts[d] = position;
+	position += c;
+      }
+      for (vint i = 0; i < count; i++) {
+	to[counts[(from[i] >> shift) & (SORT_VINTS_RADIX - 1)]++] = from[i];
+      }
+      tmp = from; from = to; to = tmp;
+    }
+    if (from != table) {
+      memcpy(table, from, count*sizeof(vint));
+    }
+  }
+}
+
+/* Parse a size in bytes with an optional suffix K, M, G or T (powers of
+   1024). Returns -1 if the size is not valid. */
+vint parse_size(char *string) {
+  char *end;
+  vint size = strtol(string, &end, 10);
+  if (end == string || size < 0) {
+    return -1;
+  }
+  switch (*end) {
+  case 'T': case 't': size <<= 10; /* fall through */
+  case 'G': case 'g': size <<= 10; /* fall through */
+  case 'M': case 'm': size <<= 10; /* fall through */
+  case 'K': case 'k': size <<= 10; end++; break;
+  case 0: break;
+  default: return -1;
+  }
+  return (*end == 0 ? size : -1);
 }
@@ -22,4 +22,12 @@
 vint *new_vint_table(vint nelem, vint init);
 int cmp_vint(const void *a, const void *b);
 
+/* Tables of at most this many vints are sorted by insertion sort */
+#define SORT_VINTS_SMALL 32
+#define SORT_VINTS_RADIX_BITS 8
+#define SORT_VINTS_RADIX (1 << SORT_VINTS_RADIX_BITS)
+
+void sort_vints(vint *table, vint count, vint limit, vint *buffer);
+vint parse_size(char *string);
+
 #endif
@@ -0,0 +1,190 @@
+"""
+Python bindings of libstacktc with NumPy.
+
+The transitive closure is computed by the C library, and the tables of the
+closure are returned as NumPy arrays that share the memory of the closure
+without copying. An array keeps its closure alive as long as it is used.
+The library calls release the GIL, so closures can be computed in several
+threads at the same time. Each thread keeps working tables of the size of
+its largest digraph for its next closure until free_workspace() is called
+in it. By default a closure computed in another thread than the main thread
+frees them at once, so that they are not lost when the thread exits; a
+thread computing many closures can pass keep_workspace=True and call
+free_workspace() when it is done. The search is recursive, so the threads
+need a large stack for deep digraphs, for example threading.stack_size(1 << 28).
+
+The library is loaded from the file given in the environment variable
+STACKTC_LIBRARY, from the system library path, or from the build directory
+src/c/.libs.
+
+    import numpy as np
+    import stacktc
+
+    closure = stacktc.Closure(stacktc.Graph(np.array([0, 1, 2]), np.array([1, 2, 0])))
+    closure.component_table        # The component of each vertex
+    closure.intervals(0)           # The successor components of component 0
+    closure.reachable(np.array([0, 2]), np.array([2, 0]))
+"""
+import ctypes
+import ctypes.util
+import os
+import threading
+from pathlib import Path
+
+import numpy as np
+
+__all__ = ['Graph', 'Closure', 'free_workspace']
+
+_id = ctypes.c_long
+_id_p = ctypes.POINTER(_id)
+_id_dtype = np.dtype(np.int64)
+
+
+def _load_library():
+    path = os.environ.get('STACKTC_LIBRARY') or ctypes.util.find_library('stacktc')
+    if path is None:
+        path = Path(__file__).resolve().parent.parent / 'c' / '.libs' / 'libstacktc.so'
+    lib = ctypes.CDLL(str(path))
+    functions = {
+        'stacktc_graph_new': (ctypes.c_void_p, [_id_p, _id_p, _id, _id]),
+        'stacktc_graph_free': (None, [ctypes.c_void_p]),
+        'stacktc_graph_vertex_count': (_id, [ctypes.c_void_p]),
+        'stacktc_graph_edge_count': (_id, [ctypes.c_void_p]),
+        'stacktc_closure_new': (ctypes.c_void_p, [ctypes.c_void_p]),
+        'stacktc_closure_free': (None, [ctypes.c_void_p]),
+        'stacktc_closure_free_workspace': (None, []),
+        'stacktc_closure_vertex_count': (_id, [ctypes.c_void_p]),
+        'stacktc_closure_component_count': (_id, [ctypes.c_void_p]),
+        'stacktc_closure_build_index': (None, [ctypes.c_void_p]),
+        'stacktc_closure_reachable_pairs': (ctypes.c_int, [ctypes.c_void_p, _id_p, _id_p, _id, ctypes.c_void_p]),
+        'stacktc_closure_component_intervals': (_id, [ctypes.c_void_p, _id, ctypes.POINTER(_id_p)]),
+        'stacktc_closure_component_table': (_id_p, [ctypes.c_void_p]),
+        'stacktc_closure_vertex_table': (_id_p, [ctypes.c_void_p, ctypes.POINTER(_id_p)]),
+    }
+    for name, (restype, argtypes) in functions.items():
+        function = getattr(lib, name)
+        function.restype = restype
+        function.argtypes = argtypes
+    return lib
+
+
+_lib = _load_library()
+
+
+def free_workspace():
+    """Free the working tables that the closures computed in this thread keep for the next closure"""
+    _lib.stacktc_closure_free_workspace()
+
+
+def _id_array(values):
+    return np.ascontiguousarray(values, dtype=_id_dtype)
+
+
+def _id_pointer(array):
+    return array.ctypes.data_as(_id_p)
+
+
+def _view(owner, pointer, shape):
+    """A read-only array of the ids at pointer that keeps owner alive"""
+    count = int(np.prod(shape))
+    if count == 0 or not pointer:
+        return np.empty(shape, dtype=_id_dtype)
+    buffer = (_id * count).from_address(ctypes.addressof(pointer.contents))
+    buffer._owner = owner
+    array = np.frombuffer(buffer, dtype=_id_dtype).reshape(shape)
+    array.flags.writeable = False
+    return array
+
+
+class Graph:
+    """A digraph with the edges from[i] -> to[i]. The vertices are 0..vertex_count-1; if vertex_count is negative,
+    it is the largest vertex in the edges plus one."""
+
+    def __init__(self, from_vertices, to_vertices, vertex_count=-1):
+        from_array = _id_array(from_vertices)
+        to_array = _id_array(to_vertices)
+        if from_array.ndim != 1 or from_array.shape != to_array.shape:
+            raise ValueError('The edge arrays must be one-dimensional and of the same length')
+        self._handle = _lib.stacktc_graph_new(_id_pointer(from_array), _id_pointer(to_array), len(from_array), vertex_count)
+        if not self._handle:
+            raise ValueError('Illegal vertex in the edges')
+
+    def __del__(self):
+        self.free()
+
+    def free(self):
+        if getattr(self, '_handle', None):
+            _lib.stacktc_graph_free(self._handle)
+            self._handle = None
+
+    @property
+    def vertex_count(self):
+        return _lib.stacktc_graph_vertex_count(self._handle)
+
+    @property
+    def edge_count(self):
+        return _lib.stacktc_graph_edge_count(self._handle)
+
+
+class _Handle:
+    """Owns a closure of the C library; the arrays of the closure refer to it"""
+
+    def __init__(self, pointer):
+        self.pointer = pointer
+
+    def __del__(self):
+        _lib.stacktc_closure_free(self.pointer)
+
+
+class Closure:
+    """The transitive closure of a graph. The graph may be freed after the closure is computed. The working tables
+    of the thread are kept for its next closure if keep_workspace is true; by default only in the main thread."""
+
+    def __init__(self, graph, keep_workspace=None):
+        pointer = _lib.stacktc_closure_new(graph._handle)
+        if keep_workspace is None:
+            keep_workspace = threading.current_thread() is threading.main_thread()
+        if not keep_workspace:
+            free_workspace()
+        if not pointer:
+            raise MemoryError('Could not compute the transitive closure')
+        self._handle = _Handle(pointer)
+        self.vertex_count = _lib.stacktc_closure_vertex_count(pointer)
+        self.component_count = _lib.stacktc_closure_component_count(pointer)
+        self.component_table = _view(self._handle, _lib.stacktc_closure_component_table(pointer), (self.vertex_count,))
+        offsets = _id_p()
+        vertices = _lib.stacktc_closure_vertex_table(pointer, ctypes.byref(offsets))
+        self.vertex_offset_table = _view(self._handle, offsets, (self.component_count + 1,))
+        self.vertex_table = _view(self._handle, vertices, (int(self.vertex_offset_table[-1]),))
+
+    def vertices(self, component):
+        """The vertices of the component"""
+        self._check_component(component)
+        return self.vertex_table[self.vertex_offset_table[component]:self.vertex_offset_table[component + 1]]
+
+    def intervals(self, component):
+        """The successor components of the component as an array of rows [low, high]"""
+        self._check_component(component)
+        table = _id_p()
+        count = _lib.stacktc_closure_component_intervals(self._handle.pointer, component, ctypes.byref(table))
+        return _view(self._handle, table, (count, 2))
+
+    def build_index(self):
+        """Faster reachable for many queries"""
+        _lib.stacktc_closure_build_index(self._handle.pointer)
+
+    def reachable(self, from_vertices, to_vertices):
+        """A boolean array telling for each i whether there is a non-empty path from from[i] to to[i]"""
+        from_array = _id_array(from_vertices)
+        to_array = _id_array(to_vertices)
+        if from_array.shape != to_array.shape:
+            raise ValueError('The vertex arrays must be of the same shape')
+        result = np.empty(from_array.shape, dtype=np.bool_)
+        if not _lib.stacktc_closure_reachable_pairs(self._handle.pointer, _id_pointer(from_array), _id_pointer(to_array),
+                                                    from_array.size, result.ctypes.data):
+            raise IndexError('Illegal vertex')
+        return result
+
+    def _check_component(self, component):
+        if component < 0 or component >= self.component_count:
+            raise IndexError(f'Illegal component {component}')